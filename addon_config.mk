@@ -0,0 +1,14 @@
+meta:
+	ADDON_NAME = ofxNanoVG
+	ADDON_DESCRIPTION = another NanoVG addon for openframeworks
+	ADDON_AUTHOR = Gal Sasson
+	ADDON_URL = https://github.com/galsasson/ofxNanoVG
+
+common:
+	# only the libraries' sources, not their examples
+	ADDON_INCLUDES = src
+	ADDON_INCLUDES += libs/nanovg/src
+	ADDON_INCLUDES += libs/nanosvg/src
+	ADDON_SOURCES_EXCLUDE = libs/nanovg/example/%
+	ADDON_SOURCES_EXCLUDE += libs/nanovg/obsolete/%
+	ADDON_SOURCES_EXCLUDE += libs/nanosvg/example/%
@@ -7,6 +7,8 @@
 //
 
 #include "ofxNanoVG.h"
+#include "ofxNanoVGSimd.h"
+#include "ofxNanoVGTextMeasure.h"
 
 #define NVG_DISABLE_FACE_CULL_FOR_TRIANGLES
 
@@ -22,6 +24,29 @@
 #define NANOSVG_IMPLEMENTATION
 #include "nanosvg.h"
 
+// NVGpoint is private to nanovg.c, testMemoryStats checks the size
+struct NVGpointLayout {
+	float x, y;
+	float dx, dy;
+	float len;
+	float dmx, dmy;
+	unsigned char flags;
+};
+
+// same as nvg__getAverageScale
+static inline float getAverageScale(const float* xform)
+{
+	float sx = sqrtf(xform[0]*xform[0] + xform[2]*xform[2]);
+	float sy = sqrtf(xform[1]*xform[1] + xform[3]*xform[3]);
+	return (sx + sy) * 0.5f;
+}
+
+// same as nvg__getFontScale, without the device pixel ratio
+static inline float getFontScale(const float* xform)
+{
+	return min((int)(getAverageScale(xform) / 0.01f + 0.5f) * 0.01f, 4.0f);
+}
+
 ofxNanoVG::~ofxNanoVG()
 {
 	if (!bInitialized) {
@@ -32,40 +57,263 @@ ofxNanoVG::~ofxNanoVG()
 	for (Font* f: fonts) {
 		delete f;
 	}
+	delete boxMeasure;
 
-#ifdef NANOVG_GL3_IMPLEMENTATION
-	nvgDeleteGL3(ctx);
-#elif defined NANOVG_GL2_IMPLEMENTATION
-	nvgDeleteGL2(ctx);
-#elif defined NANOVG_GLES2_IMPLEMENTATION
-	nvgDeleteGLES2(ctx);
-#endif
+	deleteWorkerContexts();
+	deleteContext();
 }
 
 void ofxNanoVG::setup(bool stencilStrokes, bool debug)
+{
+	setup(stencilStrokes, debug, BufferSettings());
+}
+
+void ofxNanoVG::setup(bool stencilStrokes, bool debug, const BufferSettings& buffers, int threads)
 {
 	if (bInitialized) {
 		return;
 	}
 
+	setNumThreads(threads);
+
+	createFlags = NVG_ANTIALIAS | (stencilStrokes?NVG_STENCIL_STROKES:0) | (debug?NVG_DEBUG:0);
+	bufferSettings = buffers;
+	createContext();
+
+	if (!ctx) {
+		ofLogError("error creating nanovg context");
+		return;
+	}
+
+	bInitialized = true;
+}
+
+void ofxNanoVG::setNumThreads(int threads)
+{
+	if (bInFrame) {
+		ofLogError("ofxNanoVG") << "setNumThreads was called while in a frame";
+		return;
+	}
+
+	// the worker contexts point to their thread's scratch, which may move
+	deleteWorkerContexts();
+	threadPool.setNumThreads(threads);
+	threadScratch.resize(threadPool.getNumThreads());
+}
+
+void ofxNanoVG::createContext()
+{
 #ifdef NANOVG_GL3_IMPLEMENTATION
-	ctx = nvgCreateGL3(NVG_ANTIALIAS | (stencilStrokes?NVG_STENCIL_STROKES:0) | (debug?NVG_DEBUG:0));
+	ctx = nvgCreateGL3(createFlags);
 #elif NANOVG_GL2_IMPLEMENTATION
-	ctx = nvgCreateGL2(NVG_ANTIALIAS | (stencilStrokes?NVG_STENCIL_STROKES:0) | (debug?NVG_DEBUG:0));
+	ctx = nvgCreateGL2(createFlags);
 #elif defined NANOVG_GLES2_IMPLEMENTATION
-	ctx = nvgCreateGLES2(NVG_ANTIALIAS | (stencilStrokes?NVG_STENCIL_STROKES:0) | (debug?NVG_DEBUG:0));
+	ctx = nvgCreateGLES2(createFlags);
 #endif
 
 	if (!ctx) {
-		ofLogError("error creating nanovg context");
 		return;
 	}
 
+	installRenderHooks();
+	presizeBuffers();
+
 	// set defaults
 	nvgLineCap(ctx, NVG_BUTT);
 	nvgLineJoin(ctx, NVG_MITER);
+	resetStyleState();
+	resetScissorState();
+	resetTextState();
 
-	bInitialized = true;
+	if (bGlyphAtlas) {
+		glyphAtlas.setup(ctx, glyphAtlasBudget, glyphAtlasPageSize);
+	}
+}
+
+void ofxNanoVG::deleteContext()
+{
+	if (ctx == NULL) {
+		return;
+	}
+
+	glyphAtlas.clear();
+
+#ifdef NANOVG_GL3_IMPLEMENTATION
+	nvgDeleteGL3(ctx);
+#elif defined NANOVG_GL2_IMPLEMENTATION
+	nvgDeleteGL2(ctx);
+#elif defined NANOVG_GLES2_IMPLEMENTATION
+	nvgDeleteGLES2(ctx);
+#endif
+	ctx = NULL;
+	spriteImages.clear();
+	rampImages.clear();
+	freeRampImages.clear();
+}
+
+// Grow NanoVG's path and vertex buffers (and the backend's) to the expected
+// sizes by stroking a throwaway zigzag in a cancelled frame. NanoVG keeps its
+// buffers between frames, so the real frames start with this capacity.
+void ofxNanoVG::presizeBuffers()
+{
+	int npts = max(max(bufferSettings.commands/3, bufferSettings.points), bufferSettings.vertices/2);
+	if (npts <= 0) {
+		return;
+	}
+
+	nvgBeginFrame(ctx, 1, 1, 1);
+	nvgBeginPath(ctx);
+	nvgMoveTo(ctx, 0, 0);
+	for (int i=1; i<npts; i++) {
+		nvgLineTo(ctx, i, (i%2) ? 1 : 0);
+	}
+	nvgLineJoin(ctx, NVG_BEVEL);
+	nvgStroke(ctx);
+	nvgCancelFrame(ctx);
+
+	memStats = MemoryStats();
+}
+
+void ofxNanoVG::resetFrame()
+{
+	if (!bInFrame) {
+		ofLogError("ofxNanoVG") << "resetFrame was called outside of a frame";
+		return;
+	}
+
+	nvgCancelFrame(ctx);
+	nvgBeginFrame(ctx, frameWidth, frameHeight, framePixRatio);
+	memStats.frameVertices.current = 0;
+	clearQueue();
+	resetStyleState();
+	resetScissorState();
+	resetTextState();
+	resetPathBounds();
+}
+
+void ofxNanoVG::trim()
+{
+	if (!bInitialized) {
+		return;
+	}
+
+	if (bInFrame) {
+		ofLogError("ofxNanoVG") << "trim was called while in a frame";
+		return;
+	}
+
+	deleteContext();
+	memStats = MemoryStats();
+	trimCount++;
+	createContext();
+	if (!ctx) {
+		ofLogError("ofxNanoVG") << "error recreating nanovg context";
+		bInitialized = false;
+		return;
+	}
+
+	// fonts still loading in the background are registered by processFonts
+	for (Font* font : fonts) {
+		if (font->data != NULL) {
+			font->id = nvgCreateFontMem(ctx, font->name.c_str(), const_cast<unsigned char*>(font->data), font->dataSize, 0);
+		}
+		else if (font->isLoaded()) {
+			font->id = nvgCreateFont(ctx, font->name.c_str(), ofToDataPath(font->filename).c_str());
+		}
+		if (font->id < 0) {
+			ofLogError("ofxNanoVG::trim", "could not reload font %s", font->name.c_str());
+		}
+	}
+}
+
+/*******************************************************************************
+ * Render hooks
+ ******************************************************************************/
+
+// Route the backend's render calls through ofxNanoVG to account for the
+// tessellated geometry before handing it on.
+void ofxNanoVG::installRenderHooks()
+{
+	NVGparams* params = nvgInternalParams(ctx);
+	backendParams = *params;
+	params->renderFill = renderFillHook;
+	params->renderStroke = renderStrokeHook;
+	params->renderTriangles = renderTrianglesHook;
+}
+
+// nvgArc splits the arc into bezier segments of at most 90 degrees
+int ofxNanoVG::getArcCommands(float a0, float a1, int dir)
+{
+	float da = a1 - a0;
+	if (fabsf(da) >= TWO_PI) {
+		da = TWO_PI;
+	}
+	else if (dir == NVG_CW) {
+		while (da < 0) da += TWO_PI;
+	}
+	else {
+		while (da > 0) da -= TWO_PI;
+	}
+	int ndivs = max(1, min((int)(fabsf(da) / HALF_PI + 0.5f), 5));
+	return CMD_MOVETO + ndivs*CMD_BEZIERTO;
+}
+
+void ofxNanoVG::recordPathStats(const NVGpath* paths, int npaths, size_t nverts, size_t commands)
+{
+	size_t npoints = 0;
+	for (int i=0; i<npaths; i++) {
+		npoints += paths[i].count;
+	}
+
+	recordUsage(memStats.commands, commands * sizeof(float));
+	recordUsage(memStats.points, npoints * sizeof(NVGpointLayout));
+	recordUsage(memStats.paths, npaths * sizeof(NVGpath));
+	recordUsage(memStats.vertices, nverts * sizeof(NVGvertex));
+	recordUsage(memStats.frameVertices, memStats.frameVertices.current + nverts * sizeof(NVGvertex));
+}
+
+void ofxNanoVG::renderFillHook(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, const float* bounds, const NVGpath* paths, int npaths)
+{
+	ofxNanoVG& nvg = one();
+	nvg.flushQueue();
+	if (nvg.bakeState.bake != NULL) {
+		nvg.bakeState.bake->addFill(*paint, *scissor, fringe, paths, npaths);
+		return;
+	}
+	size_t nverts = 0;
+	for (int i=0; i<npaths; i++) {
+		nverts += paths[i].nfill + paths[i].nstroke;
+	}
+	nvg.recordPathStats(paths, npaths, nverts, nvg.pathCommands);
+	nvg.backendParams.renderFill(uptr, paint, scissor, fringe, bounds, paths, npaths);
+}
+
+void ofxNanoVG::renderStrokeHook(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths)
+{
+	ofxNanoVG& nvg = one();
+	nvg.flushQueue();
+	if (nvg.bakeState.bake != NULL) {
+		nvg.bakeState.bake->addStroke(*paint, *scissor, fringe, strokeWidth, paths, npaths);
+		return;
+	}
+	size_t nverts = 0;
+	for (int i=0; i<npaths; i++) {
+		nverts += paths[i].nstroke;
+	}
+	nvg.recordPathStats(paths, npaths, nverts, nvg.pathCommands);
+	nvg.backendParams.renderStroke(uptr, paint, scissor, fringe, strokeWidth, paths, npaths);
+}
+
+void ofxNanoVG::renderTrianglesHook(void* uptr, NVGpaint* paint, NVGscissor* scissor, const NVGvertex* verts, int nverts)
+{
+	ofxNanoVG& nvg = one();
+	nvg.flushQueue();
+	if (nvg.bakeState.bake != NULL) {
+		nvg.bakeState.bake->addTriangles(*paint, *scissor, verts, nverts);
+		return;
+	}
+	recordUsage(nvg.memStats.frameVertices, nvg.memStats.frameVertices.current + nverts * sizeof(NVGvertex));
+	nvg.backendParams.renderTriangles(uptr, paint, scissor, verts, nverts);
 }
 
 void ofxNanoVG::beginFrame(int width, int height, float devicePixelRatio)
@@ -83,8 +331,42 @@ void ofxNanoVG::beginFrame(int width, int height, float devicePixelRatio)
 	frameHeight = height;
 	framePixRatio = devicePixelRatio;
 
+	if (!pendingFonts.empty()) {
+		processFonts();
+	}
+
 	nvgBeginFrame(ctx, width, height, devicePixelRatio);
 	bInFrame = true;
+	memStats.frameVertices.current = 0;
+	// nvgBeginFrame starts from the default state
+	resetStyleState();
+	resetTextState();
+	resetScissorState();
+	glyphAtlas.beginFrame();
+	if (!bResumingFrame) {
+		hairlineCount = 0;
+		spriteBatchCount = 0;
+		rampFrame++;
+		glyphAtlas.resetFrameStats();
+	}
+
+	// nested frames (between pushFrame and popFrame) are always drawn in full
+	if (!bResumingFrame && framesStack.empty()) {
+		mergeDamage();
+	}
+	if (!bResumingFrame) {
+		bRecordShapes = bPicking && framesStack.empty();
+	}
+	if (!bResumingFrame && framesStack.empty() && traceWriter.isOpen()) {
+		trace = &traceWriter;
+	}
+	if (trace) {
+		trace->beginFrame(width, height, devicePixelRatio, bResumingFrame || !framesStack.empty());
+	}
+	// a trace records calls in the order they reach NanoVG
+	bQueuePaths = threadPool.getNumThreads() > 1 && trace == NULL && createWorkerContexts();
+	bTrackBounds = bDamageActive;
+	resetPathBounds();
 }
 
 void ofxNanoVG::endFrame()
@@ -93,7 +375,51 @@ void ofxNanoVG::endFrame()
 		return;
 	}
 
+	flushQueue();
+
+	if (!bResumingFrame) {
+		if (bDamageActive && bDamageDebug) {
+			drawDamageOverlay();
+		}
+		bDamageActive = false;
+		bTrackBounds = false;
+
+		if (bRecordShapes) {
+			frameShapes.build();
+			std::swap(frameShapes, pickIndex);
+			frameShapes.clear();
+			bRecordShapes = false;
+		}
+
+		releaseRampImages();
+	}
+
+	// the deletes are part of the traced frame, the player defers them like
+	// below until the frame is drawn
+	if (trace) {
+		for (int image : frameImages) {
+			trace->deleteImage(image);
+		}
+		trace->endFrame();
+	}
 	nvgEndFrame(ctx);
+	glyphAtlas.endFrame();
+
+	// images used by this frame's draws can go now
+	for (int image : frameImages) {
+		nvgDeleteImage(ctx, image);
+	}
+	frameImages.clear();
+
+	if (trace && !bResumingFrame && framesStack.empty()) {
+		if (traceFrames > 0) {
+			traceFrames--;
+		}
+		if (traceFrames == 0) {
+			traceWriter.close();
+		}
+		trace = NULL;
+	}
 
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	bInFrame = false;
@@ -114,9 +440,16 @@ void ofxNanoVG::pushFrame()
 	set.width = frameWidth;
 	set.height = frameHeight;
 	set.devicePixelRatio = framePixRatio;
+	set.damageActive = bDamageActive;
+	set.recordShapes = bRecordShapes;
 	framesStack.push(set);
 
+	bResumingFrame = true;
 	endFrame();
+	bResumingFrame = false;
+	bDamageActive = false;
+	bTrackBounds = false;
+	bRecordShapes = false;
 }
 
 void ofxNanoVG::popFrame()
@@ -129,7 +462,12 @@ void ofxNanoVG::popFrame()
 	Settings set = framesStack.top();
 	framesStack.pop();
 
+	bResumingFrame = true;
 	beginFrame(set.width, set.height, set.devicePixelRatio);
+	bResumingFrame = false;
+	bDamageActive = set.damageActive;
+	bTrackBounds = bDamageActive;
+	bRecordShapes = set.recordShapes;
 }
 
 void ofxNanoVG::flush()
@@ -138,179 +476,1636 @@ void ofxNanoVG::flush()
 		return;
 	}
 
+	bResumingFrame = true;
 	endFrame();
 	beginFrame(frameWidth, frameHeight, framePixRatio);
+	bResumingFrame = false;
 }
 
 /*******************************************************************************
- * Shapes
+ * Baking
  ******************************************************************************/
 
-void ofxNanoVG::followPolyline(const ofPolyline &line) {
-	if (line.size() == 0) {
+void ofxNanoVG::beginBake(ofxNanoVGBake &bake)
+{
+	if (!bInFrame) {
+		ofLogError("ofxNanoVG") << "beginBake was called outside of a frame";
 		return;
 	}
-
-	auto& verts = line.getVertices();
-	nvgMoveTo(ctx, verts[0].x, verts[0].y);
-	for (int i=1; i<verts.size(); i++) {
-		nvgLineTo(ctx, verts[i].x, verts[i].y);
+	if (bakeState.bake != NULL) {
+		ofLogError("ofxNanoVG") << "beginBake was called while baking";
+		return;
 	}
+
+	// queued draws were drawn before
+	flushQueue();
+
+	bakeState.bake = &bake;
+	bakeState.damageActive = bDamageActive;
+	bakeState.recordShapes = bRecordShapes;
+	bakeState.trace = trace;
+	bDamageActive = false;
+	bTrackBounds = false;
+	bRecordShapes = false;
+	trace = NULL;
 }
 
-void ofxNanoVG::followPolylineDashed(const ofPolyline &line, float onpx, float offpx) {
-	if (line.size() == 0) {
+void ofxNanoVG::endBake()
+{
+	if (bakeState.bake == NULL) {
+		ofLogError("ofxNanoVG") << "endBake was called without beginBake";
 		return;
 	}
 
-	float length = line.getPerimeter();
-	for (float t=0; t<=length-onpx; t+=onpx+offpx) {
-		ofVec2f p1 = line.getPointAtLength(t);
-		ofVec2f p2 = line.getPointAtLength(t+onpx);
-		nvgMoveTo(ctx, p1.x, p1.y);
-		nvgLineTo(ctx, p2.x, p2.y);
+	flushQueue();
+	const ofxNanoVGBake& bake = *bakeState.bake;
+	if (bake.getSkippedDraws() > 0) {
+		ofLogWarning("ofxNanoVG::endBake", "%d draws were not baked: %d with image paints (textures, text), %d with gradients, %d scissored",
+			bake.getSkippedDraws(), bake.getSkippedImages(), bake.getSkippedGradients(), bake.getSkippedScissored());
 	}
+
+	bDamageActive = bakeState.damageActive;
+	bTrackBounds = bDamageActive;
+	bRecordShapes = bakeState.recordShapes;
+	trace = bakeState.trace;
+	bakeState = BakeState();
 }
 
-void ofxNanoVG::followPath(const ofPath& path, float x, float y) {
-	if (x!=0 || y!=0) {
-		nvgTranslate(ctx, x, y);
+void ofxNanoVG::drawBake(const ofxNanoVGBake &bake)
+{
+	if (!bInFrame) {
+		bake.draw();
+		return;
 	}
 
-	for (const ofPath::Command& c : path.getCommands()) {
-		switch (c.type) {
-			case ofPath::Command::moveTo:
-				nvgMoveTo(ctx, c.to.x, c.to.y);
-				break;
-			case ofPath::Command::lineTo:
-				nvgLineTo(ctx, c.to.x, c.to.y);
-				break;
-			case ofPath::Command::bezierTo:
-				nvgBezierTo(ctx, c.cp1.x, c.cp1.y, c.cp2.x, c.cp2.y, c.to.x, c.to.y);
-				break;
-			default:
-				break;
-		}
+	if (bakeState.bake != NULL) {
+		ofLogError("ofxNanoVG") << "drawBake was called while baking";
+		return;
+	}
 
+	flush();
+	if (!bDamageActive) {
+		bake.draw();
+		return;
 	}
-	
-	if (x!=0 || y!=0) {
-		nvgTranslate(ctx, -x, -y);
+
+	// damage regions are in frame coordinates, the scissor in framebuffer pixels from the bottom
+	glEnable(GL_SCISSOR_TEST);
+	for (const ofRectangle& r : damageRegions) {
+		glScissor(r.x*framePixRatio, (frameHeight - r.y - r.height)*framePixRatio, r.width*framePixRatio, r.height*framePixRatio);
+		bake.draw();
 	}
+	glDisable(GL_SCISSOR_TEST);
 }
 
-/******
- * For convenience
- */
+/*******************************************************************************
+ * Partial redraw
+ ******************************************************************************/
 
-void ofxNanoVG::strokeLine(float x1, float y1, float x2, float y2, const ofColor& c, float width) {
-	beginPath();
-	setStrokeColor(c);
-	setStrokeWidth(width);
-	line(x1, y1, x2, y2);
-	strokePath();
+void ofxNanoVG::setPartialRedraw(bool enable)
+{
+	bPartialRedraw = enable;
+	bDamageAll = true;
+	pendingDamage.clear();
 }
 
-void ofxNanoVG::strokeRect(float x, float y, float w, float h, const ofColor& c, float width) {
-	beginPath();
-	setStrokeColor(c);
-	setStrokeWidth(width);
-	rect(x, y, w, h);
-	strokePath();
-}
+void ofxNanoVG::addDamageRect(float x, float y, float w, float h)
+{
+	if (w <= 0 || h <= 0) {
+		return;
+	}
 
-void ofxNanoVG::fillRect(float x, float y, float w, float h, const ofColor& c) {
-	beginPath();
-	setFillColor(c);
-	rect(x, y, w, h);
-	fillPath();
+	pendingDamage.push_back(ofRectangle(x, y, w, h));
 }
 
-void ofxNanoVG::strokeRoundedRect(float x, float y, float w, float h, float r, const ofColor& c, float width) {
-	beginPath();
-	setStrokeColor(c);
-	setStrokeWidth(width);
-	roundedRect(x, y, w, h, r);
-	strokePath();
+void ofxNanoVG::damageAll()
+{
+	bDamageAll = true;
 }
 
-void ofxNanoVG::fillRoundedRect(float x, float y, float w, float h, float r, const ofColor& c) {
-	beginPath();
-	setFillColor(c);
-	roundedRect(x, y, w, h, r);
-	fillPath();
+void ofxNanoVG::setMaxDamageRegions(int count)
+{
+	maxDamageRegions = max(count, 1);
 }
 
-void ofxNanoVG::strokeRoundedRect(float x, float y, float w, float h, float r_tl, float r_tr, float r_br, float r_bl, const ofColor& c, float width) {
-	beginPath();
-	setStrokeColor(c);
-	setStrokeWidth(width);
-	roundedRect(x, y, w, h, r_tl, r_tr, r_br, r_bl);
-	strokePath();
+void ofxNanoVG::setDamageDebug(bool debug)
+{
+	bDamageDebug = debug;
 }
 
-void ofxNanoVG::fillRoundedRect(float x, float y, float w, float h, float r_tl, float r_tr, float r_br, float r_bl, const ofColor& c) {
-	beginPath();
-	setFillColor(c);
-	roundedRect(x, y, w, h, r_tl, r_tr, r_br, r_bl);
-	fillPath();
-}
+// Merge the damage collected since the last frame into at most maxDamageRegions
+// pixel aligned regions. Falls back to a full redraw when they cover most of the frame.
+void ofxNanoVG::mergeDamage()
+{
+	damageRegions.clear();
+	bDamageActive = false;
 
-void ofxNanoVG::strokeEllipse(float cx, float cy, float rx, float ry, const ofColor& c, float width) {
-	beginPath();
-	setStrokeColor(c);
-	setStrokeWidth(width);
-	ellipse(cx, cy, rx, ry);
-	strokePath();
+	if (!bPartialRedraw) {
+		pendingDamage.clear();
+		return;
+	}
+
+	if (bDamageAll) {
+		bDamageAll = false;
+		pendingDamage.clear();
+		return;
+	}
+
+	ofRectangle frame(0, 0, frameWidth, frameHeight);
+	for (const ofRectangle& r : pendingDamage) {
+		if (!r.intersects(frame)) {
+			continue;
+		}
+		ofRectangle c = r.getIntersection(frame);
+		float x0 = floorf(c.x);
+		float y0 = floorf(c.y);
+		damageRegions.push_back(ofRectangle(x0, y0, ceilf(c.x+c.width)-x0, ceilf(c.y+c.height)-y0));
+	}
+	pendingDamage.clear();
+
+	// merge overlapping regions until none overlap
+	bool merged = true;
+	while (merged) {
+		merged = false;
+		for (size_t i=0; i<damageRegions.size() && !merged; i++) {
+			for (size_t j=i+1; j<damageRegions.size(); j++) {
+				if (damageRegions[i].intersects(damageRegions[j])) {
+					damageRegions[i] = damageRegions[i].getUnion(damageRegions[j]);
+					damageRegions.erase(damageRegions.begin()+j);
+					merged = true;
+					break;
+				}
+			}
+		}
+	}
+
+	// then merge the pair that wastes the least area until under the limit
+	while (damageRegions.size() > (size_t)maxDamageRegions) {
+		size_t bi = 0, bj = 1;
+		float bestWaste = 1e30f;
+		for (size_t i=0; i<damageRegions.size(); i++) {
+			for (size_t j=i+1; j<damageRegions.size(); j++) {
+				const ofRectangle& a = damageRegions[i];
+				const ofRectangle& b = damageRegions[j];
+				float waste = a.getUnion(b).getArea() - a.getArea() - b.getArea();
+				if (waste < bestWaste) {
+					bestWaste = waste;
+					bi = i;
+					bj = j;
+				}
+			}
+		}
+		damageRegions[bi] = damageRegions[bi].getUnion(damageRegions[bj]);
+		damageRegions.erase(damageRegions.begin()+bj);
+	}
+
+	float area = 0;
+	for (const ofRectangle& r : damageRegions) {
+		area += r.getArea();
+	}
+	if (area > frame.getArea() * 0.75f) {
+		damageRegions.clear();
+		return;
+	}
+
+	// an empty region list means nothing has changed, everything gets culled
+	bDamageActive = true;
+}
+
+void ofxNanoVG::drawDamaged(bool stroke)
+{
+	float bounds[4] = { pathBounds[0], pathBounds[1], pathBounds[2], pathBounds[3] };
+	bool known = bounds[0] <= bounds[2];
+
+	if (known) {
+		// grow by the stroke extent (miter joins can reach miterLimit*width/2) and AA fringe
+		float xform[6];
+		nvgCurrentTransform(ctx, xform);
+		float scale = getAverageScale(xform);
+		float pad = 1;
+		if (stroke) {
+			pad += strokeWidth * 0.5f * scale * (lineJoin == NVG_MITER ? 10.0f : 1.5f);
+		}
+		bounds[0] -= pad;
+		bounds[1] -= pad;
+		bounds[2] += pad;
+		bounds[3] += pad;
+	}
+
+	drawInDamage(known ? bounds : NULL, [this, stroke]() {
+		if (stroke) {
+			if (trace) {
+				traceOp()->stroke();
+			}
+			nvgStroke(ctx);
+		}
+		else {
+			if (trace) {
+				trace->fill();
+			}
+			nvgFill(ctx);
+		}
+	});
+}
+
+// Call draw once per damage region the bounds (frame coordinates) touch, scissored
+// to that region. NULL bounds are treated as covering the whole frame.
+void ofxNanoVG::drawInDamage(const float *bounds, const std::function<void ()> &draw)
+{
+	float xform[6];
+	nvgCurrentTransform(ctx, xform);
+
+	for (const ofRectangle& r : damageRegions) {
+		if (bounds != NULL &&
+			(bounds[2] < r.x || bounds[0] > r.x+r.width || bounds[3] < r.y || bounds[1] > r.y+r.height)) {
+			continue;
+		}
+
+		nvgSave(ctx);
+		nvgResetTransform(ctx);
+		if (trace) {
+			trace->save();
+		}
+		if (bScissor) {
+			nvgIntersectScissor(ctx, r.x, r.y, r.width, r.height);
+			if (trace) {
+				traceOp()->intersectScissor(r.x, r.y, r.width, r.height);
+			}
+		}
+		else {
+			nvgScissor(ctx, r.x, r.y, r.width, r.height);
+			if (trace) {
+				traceOp()->scissor(r.x, r.y, r.width, r.height);
+			}
+		}
+		nvgTransform(ctx, xform[0], xform[1], xform[2], xform[3], xform[4], xform[5]);
+		draw();
+		nvgRestore(ctx);
+		if (trace) {
+			trace->restore();
+		}
+	}
+}
+
+void ofxNanoVG::drawDamageOverlay()
+{
+	nvgSave(ctx);
+	nvgResetTransform(ctx);
+	nvgResetScissor(ctx);
+	nvgBeginPath(ctx);
+	for (const ofRectangle& r : damageRegions) {
+		nvgRect(ctx, r.x+0.5f, r.y+0.5f, r.width-1, r.height-1);
+	}
+	nvgStrokeColor(ctx, nvgRGBA(255, 0, 0, 200));
+	nvgStrokeWidth(ctx, 1);
+	nvgStroke(ctx);
+	nvgRestore(ctx);
+}
+
+/*******************************************************************************
+ * Tracing
+ ******************************************************************************/
+
+bool ofxNanoVG::beginTrace(const string &filename, int frames)
+{
+	if (frames == 0) {
+		return false;
+	}
+
+	if (trace) {
+		ofLogError("ofxNanoVG::beginTrace", "a trace is already being captured");
+		return false;
+	}
+
+	if (!traceWriter.open(filename)) {
+		return false;
+	}
+	traceFrames = frames;
+	return true;
+}
+
+void ofxNanoVG::endTrace()
+{
+	if (trace) {
+		traceFrames = 0;
+		return;
+	}
+	traceWriter.close();
+}
+
+// paints are recorded with the transform they were set under; images they
+// use become placeholders of the same size unless already in the trace
+void ofxNanoVG::tracePaint(const NVGpaint &paint, bool stroke)
+{
+	if (paint.image != 0 && !trace->hasImage(paint.image)) {
+		int w = 0, h = 0;
+		nvgImageSize(ctx, paint.image, &w, &h);
+		trace->image(paint.image, w, h, 0, NULL);
+	}
+
+	if (stroke) {
+		traceOp()->strokePaint(paint);
+	}
+	else {
+		traceOp()->fillPaint(paint);
+	}
+}
+
+void ofxNanoVG::traceTextState(Font *font, float fontSize, float lineHeight)
+{
+	if (!trace->hasFont(font->id)) {
+		trace->font(font->id, font->name, font->data, font->dataSize);
+	}
+	trace->fontFace(font->id);
+	trace->letterSpacing(font->letterSpacing);
+	if (lineHeight >= 0) {
+		trace->lineHeight(lineHeight);
+	}
+	trace->fontSize(fontSize);
+}
+
+/*******************************************************************************
+ * Picking
+ ******************************************************************************/
+
+// The recorder mirrors the path commands in frame coordinates, flattened with
+// a tolerance of about a quarter pixel, close to what NanoVG tessellates.
+
+void ofxNanoVG::recordMoveTo(float x, float y)
+{
+	float xform[6];
+	nvgCurrentTransform(ctx, xform);
+	ofVec2f p;
+	nvgTransformPoint(&p.x, &p.y, xform, x, y);
+
+	ofxNanoVGShapeIndex::Contour c;
+	c.first = pathPoints.size();
+	c.count = 1;
+	c.closed = false;
+	c.hole = false;
+	pathContours.push_back(c);
+	pathPoints.push_back(p);
+}
+
+void ofxNanoVG::recordLineTo(float x, float y)
+{
+	if (pathContours.empty()) {
+		recordMoveTo(x, y);
+		return;
+	}
+
+	float xform[6];
+	nvgCurrentTransform(ctx, xform);
+	ofVec2f p;
+	nvgTransformPoint(&p.x, &p.y, xform, x, y);
+	pathPoints.push_back(p);
+	pathContours.back().count++;
+}
+
+void ofxNanoVG::recordBezierTo(float cx1, float cy1, float cx2, float cy2, float x, float y)
+{
+	if (pathContours.empty()) {
+		recordMoveTo(cx1, cy1);
+	}
+
+	float xform[6];
+	nvgCurrentTransform(ctx, xform);
+	ofVec2f p0 = pathPoints.back();
+	ofVec2f p1, p2, p3;
+	nvgTransformPoint(&p1.x, &p1.y, xform, cx1, cy1);
+	nvgTransformPoint(&p2.x, &p2.y, xform, cx2, cy2);
+	nvgTransformPoint(&p3.x, &p3.y, xform, x, y);
+
+	float hull = p0.distance(p1) + p1.distance(p2) + p2.distance(p3);
+	int n = ofClamp(ceilf(sqrtf(hull * framePixRatio * 2)), 2, 64);
+	size_t first = pathPoints.size();
+	pathPoints.resize(first + n);
+	ofxNanoVGSimd::flattenBezier(&p0.x, &p1.x, &p2.x, &p3.x, n, &pathPoints[first].x);
+	pathContours.back().count += n;
+}
+
+void ofxNanoVG::recordArc(float cx, float cy, float r, float a0, float a1, int dir)
+{
+	// same sweep rules as nvgArc
+	float da = a1 - a0;
+	if (dir == NVG_CW) {
+		if (fabsf(da) >= TWO_PI) {
+			da = TWO_PI;
+		} else {
+			while (da < 0) da += TWO_PI;
+		}
+	} else {
+		if (fabsf(da) >= TWO_PI) {
+			da = -TWO_PI;
+		} else {
+			while (da > 0) da -= TWO_PI;
+		}
+	}
+
+	float xform[6];
+	nvgCurrentTransform(ctx, xform);
+	float len = fabsf(da) * r * getAverageScale(xform) * framePixRatio;
+	int n = ofClamp(ceilf(sqrtf(len * 2)), 4, 128);
+	for (int i=0; i<=n; i++) {
+		float a = a0 + da * i / n;
+		float x = cx + cosf(a)*r;
+		float y = cy + sinf(a)*r;
+		if (i == 0 && pathContours.empty()) {
+			recordMoveTo(x, y);
+		} else {
+			recordLineTo(x, y);
+		}
+	}
+}
+
+void ofxNanoVG::recordEllipse(float cx, float cy, float rx, float ry)
+{
+	float xform[6];
+	nvgCurrentTransform(ctx, xform);
+	float len = TWO_PI * max(rx, ry) * getAverageScale(xform) * framePixRatio;
+	int n = ofClamp(ceilf(sqrtf(len * 2)), 8, 128);
+	recordMoveTo(cx + rx, cy);
+	for (int i=1; i<n; i++) {
+		float a = TWO_PI * i / n;
+		recordLineTo(cx + cosf(a)*rx, cy + sinf(a)*ry);
+	}
+	pathContours.back().closed = true;
+}
+
+void ofxNanoVG::recordRoundedRect(float x, float y, float w, float h, float r_tl, float r_tr, float r_br, float r_bl)
+{
+	// radii are clamped like nvgRoundedRect4 does
+	float halfw = fabsf(w)*0.5f;
+	float halfh = fabsf(h)*0.5f;
+	float sx = w < 0 ? -1 : 1;
+	float sy = h < 0 ? -1 : 1;
+	float corners[4][4] = {	// corner x, y, radius, start angle
+		{ x+w, y, min(r_tr, min(halfw, halfh)), -HALF_PI },
+		{ x+w, y+h, min(r_br, min(halfw, halfh)), 0 },
+		{ x, y+h, min(r_bl, min(halfw, halfh)), HALF_PI },
+		{ x, y, min(r_tl, min(halfw, halfh)), PI }
+	};
+	float dirs[4][2] = { {-1, 1}, {-1, -1}, {1, -1}, {1, 1} };
+
+	bool first = true;
+	for (int i=0; i<4; i++) {
+		float r = corners[i][2];
+		int n = r < 0.5f ? 0 : 6;
+		float cx = corners[i][0] + dirs[i][0]*r*sx;
+		float cy = corners[i][1] + dirs[i][1]*r*sy;
+		for (int j=0; j<=n; j++) {
+			float a = corners[i][3] + HALF_PI * j / max(n, 1);
+			float px = n == 0 ? corners[i][0] : cx + cosf(a)*r*sx;
+			float py = n == 0 ? corners[i][1] : cy + sinf(a)*r*sy;
+			if (first) {
+				recordMoveTo(px, py);
+				first = false;
+			} else {
+				recordLineTo(px, py);
+			}
+		}
+	}
+	pathContours.back().closed = true;
+}
+
+void ofxNanoVG::recordShape(bool stroke)
+{
+	if (shapeId < 0 || pathContours.empty()) {
+		return;
+	}
+
+	if (stroke) {
+		float xform[6];
+		nvgCurrentTransform(ctx, xform);
+		frameShapes.addShape(shapeId, ofxNanoVGShapeIndex::SHAPE_STROKE, strokeWidth * getAverageScale(xform), &pathPoints[0], &pathContours[0], pathContours.size());
+	} else {
+		frameShapes.addShape(shapeId, ofxNanoVGShapeIndex::SHAPE_FILL, 0, &pathPoints[0], &pathContours[0], pathContours.size());
+	}
+}
+
+// bounds are in local coordinates, as returned by nvgTextBounds
+void ofxNanoVG::recordBoxShape(const float *bounds)
+{
+	if (shapeId < 0) {
+		return;
+	}
+
+	float xform[6];
+	nvgCurrentTransform(ctx, xform);
+	ofVec2f box[4];
+	nvgTransformPoint(&box[0].x, &box[0].y, xform, bounds[0], bounds[1]);
+	nvgTransformPoint(&box[1].x, &box[1].y, xform, bounds[2], bounds[1]);
+	nvgTransformPoint(&box[2].x, &box[2].y, xform, bounds[2], bounds[3]);
+	nvgTransformPoint(&box[3].x, &box[3].y, xform, bounds[0], bounds[3]);
+
+	ofxNanoVGShapeIndex::Contour c;
+	c.first = 0;
+	c.count = 4;
+	c.closed = true;
+	c.hole = false;
+	frameShapes.addShape(shapeId, ofxNanoVGShapeIndex::SHAPE_FILL, 0, box, &c, 1);
+}
+
+// points are already in frame coordinates
+void ofxNanoVG::recordStripShape(int id, const float* points, int npts, bool closed, float width)
+{
+	if (id < 0 || npts < 2) {
+		return;
+	}
+
+	ofxNanoVGShapeIndex::Contour c;
+	c.first = 0;
+	c.count = npts;
+	c.closed = closed;
+	c.hole = false;
+	frameShapes.addShape(id, ofxNanoVGShapeIndex::SHAPE_STROKE, width, (const ofVec2f*)points, &c, 1);
+}
+
+/*******************************************************************************
+ * Shapes
+ ******************************************************************************/
+
+void ofxNanoVG::followPolyline(const ofPolyline &line) {
+	if (line.size() == 0) {
+		return;
+	}
+
+	auto& verts = line.getVertices();
+	nvgMoveTo(ctx, verts[0].x, verts[0].y);
+	for (int i=1; i<verts.size(); i++) {
+		nvgLineTo(ctx, verts[i].x, verts[i].y);
+	}
+	pathCommands += CMD_MOVETO + (verts.size()-1) * CMD_LINETO;
+
+	if (trace) {
+		traceOp()->moveTo(verts[0].x, verts[0].y);
+		for (size_t i=1; i<verts.size(); i++) {
+			trace->lineTo(verts[i].x, verts[i].y);
+		}
+	}
+	if (bPathOps) {
+		float count = verts.size();
+		addPathOp(PATH_POLYLINE, &count, 1);
+		for (const auto& v : verts) {
+			pathOps.push_back(v.x);
+			pathOps.push_back(v.y);
+		}
+	}
+	if (bTrackBounds) {
+		ofRectangle box = line.getBoundingBox();
+		trackBox(box.x, box.y, box.x+box.width, box.y+box.height);
+	}
+	if (bRecordShapes) {
+		recordMoveTo(verts[0].x, verts[0].y);
+		for (size_t i=1; i<verts.size(); i++) {
+			recordLineTo(verts[i].x, verts[i].y);
+		}
+	}
+}
+
+void ofxNanoVG::followPolylineDashed(const ofPolyline &line, float onpx, float offpx) {
+	if (line.size() == 0) {
+		return;
+	}
+
+	float length = line.getPerimeter();
+	for (float t=0; t<=length-onpx; t+=onpx+offpx) {
+		ofVec2f p1 = line.getPointAtLength(t);
+		ofVec2f p2 = line.getPointAtLength(t+onpx);
+		nvgMoveTo(ctx, p1.x, p1.y);
+		nvgLineTo(ctx, p2.x, p2.y);
+		pathCommands += CMD_MOVETO + CMD_LINETO;
+		if (trace) {
+			traceOp()->moveTo(p1.x, p1.y);
+			trace->lineTo(p2.x, p2.y);
+		}
+		if (bRecordShapes) {
+			recordMoveTo(p1.x, p1.y);
+			recordLineTo(p2.x, p2.y);
+		}
+		if (bPathOps) {
+			const float args[] = { p1.x, p1.y, p2.x, p2.y };
+			addPathOp(PATH_MOVETO, args, 2);
+			addPathOp(PATH_LINETO, args+2, 2);
+		}
+	}
+
+	if (bTrackBounds) {
+		ofRectangle box = line.getBoundingBox();
+		trackBox(box.x, box.y, box.x+box.width, box.y+box.height);
+	}
+}
+
+void ofxNanoVG::followPath(const ofPath& path, float x, float y) {
+	if (x!=0 || y!=0) {
+		nvgTranslate(ctx, x, y);
+	}
+
+	for (const ofPath::Command& c : path.getCommands()) {
+		switch (c.type) {
+			case ofPath::Command::moveTo:
+				moveTo(c.to.x, c.to.y);
+				break;
+			case ofPath::Command::lineTo:
+				lineTo(c.to.x, c.to.y);
+				break;
+			case ofPath::Command::bezierTo:
+				bezierTo(c.cp1.x, c.cp1.y, c.cp2.x, c.cp2.y, c.to.x, c.to.y);
+				break;
+			default:
+				break;
+		}
+
+	}
+	
+	if (x!=0 || y!=0) {
+		nvgTranslate(ctx, -x, -y);
+	}
+}
+
+/******
+ * For convenience
+ */
+
+void ofxNanoVG::strokeLine(float x1, float y1, float x2, float y2, const ofColor& c, float width) {
+	beginPath();
+	setStrokeColor(c);
+	setStrokeWidth(width);
+	if (isHairline(width)) {
+		float pts[4] = { x1, y1, x2, y2 };
+		polylinePoints.assign(pts, pts+4);
+		strokeHairline(c, width, false);
+		return;
+	}
+	line(x1, y1, x2, y2);
+	strokePath();
+}
+
+void ofxNanoVG::strokeRect(float x, float y, float w, float h, const ofColor& c, float width) {
+	beginPath();
+	setStrokeColor(c);
+	setStrokeWidth(width);
+	if (isHairline(width)) {
+		float pts[8] = { x, y, x+w, y, x+w, y+h, x, y+h };
+		polylinePoints.assign(pts, pts+8);
+		strokeHairline(c, width, true);
+		return;
+	}
+	rect(x, y, w, h);
+	strokePath();
+}
+
+void ofxNanoVG::fillRect(float x, float y, float w, float h, const ofColor& c) {
+	beginPath();
+	setFillColor(c);
+	rect(x, y, w, h);
+	fillPath();
+}
+
+void ofxNanoVG::strokeRoundedRect(float x, float y, float w, float h, float r, const ofColor& c, float width) {
+	beginPath();
+	setStrokeColor(c);
+	setStrokeWidth(width);
+	roundedRect(x, y, w, h, r);
+	strokePath();
+}
+
+void ofxNanoVG::fillRoundedRect(float x, float y, float w, float h, float r, const ofColor& c) {
+	beginPath();
+	setFillColor(c);
+	roundedRect(x, y, w, h, r);
+	fillPath();
+}
+
+void ofxNanoVG::strokeRoundedRect(float x, float y, float w, float h, float r_tl, float r_tr, float r_br, float r_bl, const ofColor& c, float width) {
+	beginPath();
+	setStrokeColor(c);
+	setStrokeWidth(width);
+	roundedRect(x, y, w, h, r_tl, r_tr, r_br, r_bl);
+	strokePath();
+}
+
+void ofxNanoVG::fillRoundedRect(float x, float y, float w, float h, float r_tl, float r_tr, float r_br, float r_bl, const ofColor& c) {
+	beginPath();
+	setFillColor(c);
+	roundedRect(x, y, w, h, r_tl, r_tr, r_br, r_bl);
+	fillPath();
+}
+
+void ofxNanoVG::strokeEllipse(float cx, float cy, float rx, float ry, const ofColor& c, float width) {
+	beginPath();
+	setStrokeColor(c);
+	setStrokeWidth(width);
+	ellipse(cx, cy, rx, ry);
+	strokePath();
+}
+
+void ofxNanoVG::fillEllipse(float cx, float cy, float rx, float ry, const ofColor& c) {
+	beginPath();
+	setFillColor(c);
+	ellipse(cx, cy, rx, ry);
+	fillPath();
+}
+
+void ofxNanoVG::strokeCircle(float cx, float cy, float r, const ofColor& c, float width) {
+	beginPath();
+	setStrokeColor(c);
+	setStrokeWidth(width);
+	circle(cx, cy, r);
+	strokePath();
+}
+
+void ofxNanoVG::fillCircle(float cx, float cy, float r, const ofColor& c) {
+	beginPath();
+	setFillColor(c);
+	circle(cx, cy, r);
+	fillPath();
+}
+
+void ofxNanoVG::strokeArc(float cx, float cy, float r, float a0, float a1, int dir, const ofColor& c, float width)
+{
+	beginPath();
+	setStrokeColor(c);
+	setStrokeWidth(width);
+	arc(cx, cy, r, a0, a1, dir);
+	strokePath();
+}
+
+void ofxNanoVG::fillArc(float cx, float cy, float r, float a0, float a1, int dir, const ofColor& c)
+{
+	beginPath();
+	setFillColor(c);
+	arc(cx, cy, r, a0, a1, dir);
+	strokePath();
+}
+
+void ofxNanoVG::strokePolyline(const ofPolyline &line, const ofColor &c, float width) {
+	beginPath();
+	setStrokeColor(c);
+	setStrokeWidth(width);
+	if (line.size() > 1 && isHairline(width)) {
+		auto& verts = line.getVertices();
+		polylinePoints.resize(verts.size()*2);
+		for (size_t i=0; i<verts.size(); i++) {
+			polylinePoints[i*2] = verts[i].x;
+			polylinePoints[i*2+1] = verts[i].y;
+		}
+		strokeHairline(c, width, line.isClosed());
+		return;
+	}
+	followPolyline(line);
+	strokePath();
+}
+
+/******
+ * Hairlines and colored polylines
+ */
+
+bool ofxNanoVG::isHairline(float width)
+{
+	if (!bHairlineFastPath || !bInFrame) {
+		return false;
+	}
+
+	float xform[6];
+	nvgCurrentTransform(ctx, xform);
+	return width * getAverageScale(xform) * framePixRatio <= 1.0f;
+}
+
+// Transform a polyline to frame coordinates, dropping repeated points (they
+// have no direction), and compute the averaged left normal of every point,
+// extended like a miter but capped for sharp turns. Returns the point count,
+// closed is cleared for closed lines with less than three points. indices
+// receives the source index of every point that was kept, dirs is scratch.
+static int preparePolyline(const float* xform, const float* pts, int npts, bool& closed, vector<float>& p, vector<float>& normals, vector<float>& dirs, vector<int>* indices=NULL)
+{
+	p.resize(npts*2);
+	ofxNanoVGSimd::transformPoints(xform, pts, &p[0], npts);
+
+	// drop repeated points in place
+	if (indices != NULL) {
+		indices->clear();
+	}
+	int n = 0;
+	for (int i=0; i<npts; i++) {
+		float x = p[i*2];
+		float y = p[i*2+1];
+		if (n > 0 && fabsf(p[n*2-2]-x) < 1e-5f && fabsf(p[n*2-1]-y) < 1e-5f) {
+			continue;
+		}
+		p[n*2] = x;
+		p[n*2+1] = y;
+		n++;
+		if (indices != NULL) {
+			indices->push_back(i);
+		}
+	}
+	p.resize(n*2);
+	npts = n;
+	if (closed && npts > 2 && fabsf(p[0]-p[npts*2-2]) < 1e-5f && fabsf(p[1]-p[npts*2-1]) < 1e-5f) {
+		npts--;
+	}
+	if (npts < 2) {
+		return 0;
+	}
+	closed = closed && npts > 2;
+
+	int nsegs = closed ? npts : npts-1;
+	dirs.resize(nsegs*2);
+	ofxNanoVGSimd::segmentDirections(&p[0], npts, closed, &dirs[0]);
+
+	normals.resize(npts*2);
+	for (int i=0; i<npts; i++) {
+		int s0 = closed ? (i+nsegs-1) % nsegs : max(i-1, 0);
+		int s1 = closed ? i : min(i, nsegs-1);
+		float dmx = (dirs[s0*2+1] + dirs[s1*2+1]) * 0.5f;
+		float dmy = (-dirs[s0*2] - dirs[s1*2]) * 0.5f;
+		float dmr2 = dmx*dmx + dmy*dmy;
+		if (dmr2 > 0.25f) {
+			dmx /= dmr2;
+			dmy /= dmr2;
+		}
+		else if (dmr2 > 1e-6f) {
+			float s = 1.0f / sqrtf(dmr2);
+			dmx *= s;
+			dmy *= s;
+		}
+		else {
+			dmx = dirs[s1*2+1];
+			dmy = -dirs[s1*2];
+		}
+		normals[i*2] = dmx;
+		normals[i*2+1] = dmy;
+	}
+
+	return npts;
+}
+
+// Expand a prepared polyline into a stroke triangle strip the way
+// nvg__expandStroke does with butt caps, minus the join logic: every point gets
+// one cross-section along its normal. w is the half width including the AA
+// fringe, aa the fringe width. Writes at most npts*2+8 vertices, returns the count.
+static int expandHairline(const vector<float>& p, const vector<float>& normals, int npts, bool closed, float w, float aa, NVGvertex* verts)
+{
+	int n = 0;
+	auto vset = [verts, &n](float x, float y, float u, float v) {
+		NVGvertex vtx = { x, y, u, v };
+		verts[n++] = vtx;
+	};
+
+	if (!closed) {
+		// butt cap start, the end normal is the segment's left normal
+		float dx = -normals[1];
+		float dy = normals[0];
+		float px = p[0] + dx*aa*0.5f;
+		float py = p[1] + dy*aa*0.5f;
+		vset(px + dy*w - dx*aa, py - dx*w - dy*aa, 0, 0);
+		vset(px - dy*w - dx*aa, py + dx*w - dy*aa, 1, 0);
+		vset(px + dy*w, py - dx*w, 0, 1);
+		vset(px - dy*w, py + dx*w, 1, 1);
+	}
+
+	int first = closed ? 0 : 1;
+	int last = closed ? npts : npts-1;
+	if (last > first) {
+		ofxNanoVGSimd::crossSections(&p[first*2], &normals[first*2], last-first, w, verts + n);
+		n += (last-first)*2;
+	}
+
+	if (closed) {
+		// close the strip
+		vset(verts[0].x, verts[0].y, 0, 1);
+		vset(verts[1].x, verts[1].y, 1, 1);
+	}
+	else {
+		// butt cap end
+		float dx = -normals[npts*2-1];
+		float dy = normals[npts*2-2];
+		float px = p[npts*2-2] - dx*aa*0.5f;
+		float py = p[npts*2-1] - dy*aa*0.5f;
+		vset(px + dy*w, py - dx*w, 0, 1);
+		vset(px - dy*w, py + dx*w, 1, 1);
+		vset(px + dy*w + dx*aa, py - dx*w + dy*aa, 0, 0);
+		vset(px - dy*w + dx*aa, py + dx*w + dy*aa, 1, 0);
+	}
+
+	return n;
+}
+
+// Expand a prepared polyline into textured triangles for a color ramp: each
+// point gets a cross-section of four vertices (outer and inner edge on both
+// sides) and every segment six triangles between its two cross-sections. The
+// ramp is sampled at rampCoords[indices[i]]. Writes npts*18 vertices at most,
+// sections is scratch.
+static int expandRamp(const vector<float>& p, const vector<float>& normals, const vector<int>& indices, int npts, bool closed, const float* rampCoords, float hw, float fringe, vector<float>& sections, NVGvertex* verts)
+{
+	// offsets across the line and the texture rows they sample
+	float outer = hw + fringe*0.5f;
+	float inner = max(hw - fringe*0.5f, 0.0f);
+	const float offsets[4] = { outer, inner, -inner, -outer };
+	const float rows[4] = { 0.125f, 0.375f, 0.625f, 0.875f };
+
+	// 4 x then 4 y per point
+	sections.resize(npts*8);
+	ofxNanoVGSimd::offsetSections(&p[0], &normals[0], npts, offsets, &sections[0]);
+
+	int nsegs = closed ? npts : npts-1;
+	NVGvertex* dst = verts;
+	for (int s=0; s<nsegs; s++) {
+		int i0 = s;
+		int i1 = (s+1) % npts;
+		NVGvertex a[4], b[4];
+		for (int k=0; k<4; k++) {
+			a[k].x = sections[i0*8+k];
+			a[k].y = sections[i0*8+4+k];
+			a[k].u = rampCoords[indices[i0]];
+			a[k].v = rows[k];
+			b[k].x = sections[i1*8+k];
+			b[k].y = sections[i1*8+4+k];
+			b[k].u = rampCoords[indices[i1]];
+			b[k].v = rows[k];
+		}
+		for (int k=0; k<3; k++) {
+			*dst++ = a[k];
+			*dst++ = b[k];
+			*dst++ = b[k+1];
+			*dst++ = a[k];
+			*dst++ = b[k+1];
+			*dst++ = a[k+1];
+		}
+	}
+
+	return nsegs*18;
+}
+
+// Stroke polylinePoints (local coordinates) as a sub-pixel wide strip and hand
+// it straight to the backend, with the same paint and AA setup as nvgStroke.
+void ofxNanoVG::strokeHairline(const ofColor &c, float width, bool closed)
+{
+	// nvgStroke emulates the coverage of sub-pixel strokes with alpha
+	float xform[6];
+	nvgCurrentTransform(ctx, xform);
+	float fringe = 1.0f / framePixRatio;
+	float alpha = ofClamp(width * getAverageScale(xform) / fringe, 0, 1);
+
+	NVGpaint paint;
+	memset(&paint, 0, sizeof(paint));
+	nvgTransformIdentity(paint.xform);
+	paint.feather = 1.0f;
+	paint.innerColor = paint.outerColor = toNVGcolor(c);
+	paint.innerColor.a *= alpha*alpha;
+	paint.outerColor.a *= alpha*alpha;
+
+	queueDirect(false, paint, width, closed);
+	hairlineCount++;
+}
+
+void ofxNanoVG::strokePolyline(const ofPolyline &line, const vector<ofFloatColor> &colors, float width)
+{
+	if (colors.size() != line.size()) {
+		ofLogError("ofxNanoVG::strokePolyline") << "expected one color per vertex";
+		return;
+	}
+
+	if (line.size() < 2) {
+		return;
+	}
+
+	// texel j holds the color at vertex j*(n-1)/(w-1), vertex i samples it at its own position
+	int n = colors.size();
+	int w = min(n, MAX_RAMP_SIZE);
+	vector<ofFloatColor> ramp(w);
+	for (int j=0; j<w; j++) {
+		float t = w > 1 ? (float)j*(n-1)/(w-1) : 0;
+		int i = min((int)t, n-2);
+		ramp[j] = colors[i].getLerped(colors[i+1], t-i);
+	}
+
+	auto& verts = line.getVertices();
+	polylinePoints.resize(n*2);
+	rampCoords.resize(n);
+	for (int i=0; i<n; i++) {
+		polylinePoints[i*2] = verts[i].x;
+		polylinePoints[i*2+1] = verts[i].y;
+		rampCoords[i] = ((float)i/(n-1)*(w-1) + 0.5f) / w;
+	}
+
+	strokeRamp(ramp, width, line.isClosed());
+}
+
+void ofxNanoVG::strokePolyline(const ofPolyline &line, const vector<float> &values, const vector<ofFloatColor> &ramp, float minValue, float maxValue, float width)
+{
+	if (values.size() != line.size()) {
+		ofLogError("ofxNanoVG::strokePolyline") << "expected one value per vertex";
+		return;
+	}
+
+	if (line.size() < 2 || ramp.empty()) {
+		return;
+	}
+
+	int n = ramp.size();
+	int w = min(n, MAX_RAMP_SIZE);
+	vector<ofFloatColor> texels(w);
+	for (int j=0; j<w; j++) {
+		float t = w > 1 ? (float)j*(n-1)/(w-1) : 0;
+		int i = min((int)t, max(n-2, 0));
+		texels[j] = n > 1 ? ramp[i].getLerped(ramp[i+1], t-i) : ramp[0];
+	}
+
+	auto& verts = line.getVertices();
+	polylinePoints.resize(verts.size()*2);
+	rampCoords.resize(verts.size());
+	float range = maxValue - minValue;
+	for (size_t i=0; i<verts.size(); i++) {
+		polylinePoints[i*2] = verts[i].x;
+		polylinePoints[i*2+1] = verts[i].y;
+		float t = range != 0 ? ofClamp((values[i] - minValue) / range, 0, 1) : 0;
+		rampCoords[i] = (t*(w-1) + 0.5f) / w;
+	}
+
+	strokeRamp(texels, width, line.isClosed());
+}
+
+// Draw polylinePoints with a color ramp texture, looked up by rampCoords per
+// point, as one batch of textured triangles. Each point gets a cross-section
+// of four vertices and the texture's transparent top and bottom rows fade
+// the outer ones out over the AA fringe.
+void ofxNanoVG::strokeRamp(const vector<ofFloatColor> &ramp, float width, bool closed)
+{
+	if (!bInFrame) {
+		return;
+	}
+
+	int image = getRampImage(ramp);
+	if (image <= 0) {
+		return;
+	}
+
+	queueDirect(true, nvgImagePattern(ctx, 0, 0, 1, 1, 0, image, 1), width, closed);
+}
+
+// The ramp's texture, rows: transparent, color, color, transparent;
+// premultiplied. Textures are found by content, so a ramp drawn again in
+// the next frame isn't uploaded again, and new content is uploaded into a
+// texture of the same width that wasn't drawn in the last frame when there
+// is one.
+int ofxNanoVG::getRampImage(const vector<ofFloatColor> &ramp)
+{
+	int w = ramp.size();
+	rampRow.resize(w*4);
+	for (int j=0; j<w; j++) {
+		const ofFloatColor& c = ramp[j];
+		unsigned char* texel = &rampRow[j*4];
+		texel[0] = c.r * c.a * 255;
+		texel[1] = c.g * c.a * 255;
+		texel[2] = c.b * c.a * 255;
+		texel[3] = c.a * 255;
+	}
+
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	for (unsigned char byte : rampRow) {
+		hash = (hash ^ byte) * 1099511628211ULL;
+	}
+
+	auto getData = [this, w]() {
+		rampData.assign(w*4*4, 0);
+		memcpy(&rampData[w*4], &rampRow[0], w*4);
+		memcpy(&rampData[w*4*2], &rampRow[0], w*4);
+		return &rampData[0];
+	};
+
+	auto range = rampImages.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		RampImage& cached = it->second;
+		if (cached.row == rampRow) {
+			cached.lastUsed = rampFrame;
+			if (trace && !trace->hasImage(cached.image)) {
+				trace->image(cached.image, w, 4, NVG_IMAGE_PREMULTIPLIED, getData());
+			}
+			return cached.image;
+		}
+	}
+
+	const unsigned char* data = getData();
+	int image;
+	vector<int>& reusable = freeRampImages[w];
+	if (!reusable.empty()) {
+		image = reusable.back();
+		reusable.pop_back();
+		nvgUpdateImage(ctx, image, data);
+	}
+	else {
+		image = nvgCreateImageRGBA(ctx, w, 4, NVG_IMAGE_PREMULTIPLIED, data);
+		if (image <= 0) {
+			ofLogError("ofxNanoVG") << "error creating color ramp image";
+			return 0;
+		}
+	}
+	if (trace) {
+		trace->image(image, w, 4, NVG_IMAGE_PREMULTIPLIED, data);
+	}
+
+	RampImage cached;
+	cached.image = image;
+	cached.lastUsed = rampFrame;
+	cached.row = rampRow;
+	rampImages.insert(std::make_pair(hash, cached));
+	return image;
+}
+
+// at the end of a top level frame: textures that weren't reused since the
+// last one go, the ones this frame didn't draw can take new content
+void ofxNanoVG::releaseRampImages()
+{
+	for (auto& entry : freeRampImages) {
+		frameImages.insert(frameImages.end(), entry.second.begin(), entry.second.end());
+	}
+	freeRampImages.clear();
+
+	for (auto it = rampImages.begin(); it != rampImages.end();) {
+		if (it->second.lastUsed != rampFrame) {
+			freeRampImages[it->second.row.size()/4].push_back(it->second.image);
+			it = rampImages.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+/******
+ * Queued draws
+ *
+ * Hairlines and colored polylines are tessellated by ofxNanoVG and handed to
+ * the backend without going through NanoVG's path API (direct strokes).
+ * With more than one thread (see setup) they are queued together with the
+ * fills and strokes of regular paths, which are replayed into a headless
+ * NanoVG context per thread and tessellated there by NanoVG itself. The
+ * queue is tessellated on the thread pool right before the next draw that
+ * reaches the backend (or at endFrame) and drawn in the order it was queued.
+ * Every direct stroke writes into its own slice of the shared buffers,
+ * reserved up front for the worst case, and every path into the scratch of
+ * the thread that tessellated it, so the output does not depend on how the
+ * work was scheduled.
+ */
+
+#define MIN_PARALLEL_POINTS 1024
+
+void ofxNanoVG::queueDirect(bool ramp, const NVGpaint &paint, float width, bool closed)
+{
+	DirectStroke stroke;
+	stroke.ramp = ramp;
+	stroke.closed = closed;
+	stroke.order = directStrokes.size() + queuedPaths.size();
+	nvgCurrentTransform(ctx, stroke.xform);
+	stroke.scissor = scissor;
+	stroke.paint = paint;
+	stroke.width = width;
+	stroke.firstPoint = directPoints.size()/2;
+	stroke.npts = polylinePoints.size()/2;
+	stroke.firstRamp = directRampCoords.size();
+	stroke.nverts = 0;
+
+	// recorded now, so shapes drawn later don't need the queue flushed
+	if (bRecordShapes && shapeId >= 0 && stroke.npts >= 2) {
+		pickPoints.resize(polylinePoints.size());
+		ofxNanoVGSimd::transformPoints(stroke.xform, &polylinePoints[0], &pickPoints[0], stroke.npts);
+		recordStripShape(shapeId, &pickPoints[0], stroke.npts, closed && stroke.npts > 2, width * getAverageScale(stroke.xform));
+	}
+
+	directPoints.insert(directPoints.end(), polylinePoints.begin(), polylinePoints.end());
+	if (ramp) {
+		directRampCoords.insert(directRampCoords.end(), rampCoords.begin(), rampCoords.end());
+	}
+	directStrokes.push_back(stroke);
+
+	// a trace records calls in the order they reach NanoVG, so it isn't batched
+	if (threadPool.getNumThreads() == 1 || trace != NULL) {
+		flushQueue();
+	}
+}
+
+// instead of nvgFill or nvgStroke, with the path and the state that decide
+// its tessellation
+void ofxNanoVG::queuePath(bool stroke)
+{
+	if ((int)pathOps.size() == pathStart) {
+		return;
+	}
+
+	QueuedPath path;
+	path.stroke = stroke;
+	path.order = directStrokes.size() + queuedPaths.size();
+	path.firstOp = pathStart;
+	path.endOp = pathOps.size();
+	path.commands = pathCommands;
+	nvgCurrentTransform(ctx, path.xform);
+	path.scissor = scissor;
+	path.paint = stroke ? strokePaint : fillPaint;
+	path.strokeWidth = strokeWidth;
+	path.lineCap = lineCap;
+	path.lineJoin = lineJoin;
+	path.thread = 0;
+	path.firstPath = 0;
+	path.npaths = 0;
+	queuedPaths.push_back(path);
+	bPathQueued = true;
+}
+
+void ofxNanoVG::flushQueue()
+{
+	if ((directStrokes.empty() && queuedPaths.empty()) || bFlushingQueue) {
+		return;
+	}
+	bFlushingQueue = true;
+
+	size_t nverts = 0;
+	for (DirectStroke& stroke : directStrokes) {
+		stroke.firstVert = nverts;
+		nverts += stroke.ramp ? stroke.npts*18 : stroke.npts*2 + 8;
+	}
+	directVerts.resize(nverts);
+	for (ThreadScratch& scratch : threadScratch) {
+		scratch.paths.clear();
+		scratch.pathVerts.clear();
+		scratch.verts.clear();
+	}
+
+	// direct strokes first, then paths
+	int ndirect = directStrokes.size();
+	float fringe = 1.0f / framePixRatio;
+	auto tessellate = [this, ndirect, fringe](int i, int thread) {
+		if (i < ndirect) {
+			DirectStroke& stroke = directStrokes[i];
+			tessellateDirect(stroke, threadScratch[thread], &directPoints[0], directRampCoords.empty() ? NULL : &directRampCoords[0], fringe,
+				&directVerts[stroke.firstVert]);
+		}
+		else {
+			tessellatePath(queuedPaths[i - ndirect], thread);
+		}
+	};
+	int count = ndirect + queuedPaths.size();
+	// a path counts the floats of its calls as points
+	size_t work = directPoints.size()/2;
+	for (const QueuedPath& path : queuedPaths) {
+		work += path.endOp - path.firstOp;
+	}
+	if (work < MIN_PARALLEL_POINTS) {
+		for (int i=0; i<count; i++) {
+			tessellate(i, 0);
+		}
+	}
+	else {
+		threadPool.parallelFor(count, tessellate);
+	}
+
+	// in the order they were queued
+	size_t d = 0, q = 0;
+	while (d < directStrokes.size() || q < queuedPaths.size()) {
+		if (q == queuedPaths.size() || (d < directStrokes.size() && directStrokes[d].order < queuedPaths[q].order)) {
+			drawDirect(directStrokes[d], &directVerts[directStrokes[d].firstVert]);
+			d++;
+		}
+		else {
+			drawQueuedPath(queuedPaths[q]);
+			q++;
+		}
+	}
+
+	clearQueue();
+	bFlushingQueue = false;
+}
+
+// drop the queue, keeping the current path's calls for the draws still to come
+void ofxNanoVG::clearQueue()
+{
+	directStrokes.clear();
+	directPoints.clear();
+	directRampCoords.clear();
+	queuedPaths.clear();
+	pathOps.erase(pathOps.begin(), pathOps.begin() + pathStart);
+	pathStart = 0;
+	bPathQueued = false;
+}
+
+// Runs on the pool's threads: only touches the stroke, its own slice and the
+// thread's scratch.
+void ofxNanoVG::tessellateDirect(DirectStroke &stroke, ThreadScratch& scratch, const float *points, const float *coords, float fringe, NVGvertex *verts)
+{
+	vector<float>& p = scratch.points;
+	vector<float>& normals = scratch.normals;
+	bool closed = stroke.closed;
+	int npts = preparePolyline(stroke.xform, points + stroke.firstPoint*2, stroke.npts, closed, p, normals, scratch.dirs, stroke.ramp ? &scratch.indices : NULL);
+	stroke.closed = closed;
+	if (npts == 0) {
+		stroke.nverts = 0;
+		return;
+	}
+
+	if (stroke.ramp) {
+		float hw = stroke.width * getAverageScale(stroke.xform) * 0.5f;
+		stroke.nverts = expandRamp(p, normals, scratch.indices, npts, closed, coords + stroke.firstRamp, hw, fringe, scratch.sections, verts);
+	}
+	else {
+		stroke.nverts = expandHairline(p, normals, npts, closed, fringe, fringe, verts);
+	}
+}
+
+// Runs on the pool's threads: replays the path into the thread's context,
+// which hands the result to captureFill or captureStroke.
+void ofxNanoVG::tessellatePath(QueuedPath &path, int thread)
+{
+	ThreadScratch& scratch = threadScratch[thread];
+	NVGcontext* worker = scratch.ctx;
+	path.thread = thread;
+	scratch.capture = &path;
+
+	// from the default state, with the paint set under the identity transform
+	nvgBeginFrame(worker, frameWidth, frameHeight, framePixRatio);
+	if (path.stroke) {
+		nvgStrokePaint(worker, path.paint);
+		nvgStrokeWidth(worker, path.strokeWidth);
+		nvgLineCap(worker, path.lineCap);
+		nvgLineJoin(worker, path.lineJoin);
+	}
+	else {
+		nvgFillPaint(worker, path.paint);
+	}
+
+	nvgBeginPath(worker);
+	const float* op = &pathOps[path.firstOp];
+	const float* end = &pathOps[0] + path.endOp;
+	while (op < end) {
+		const float* a = op + 1;
+		switch ((int)op[0]) {
+			case PATH_XFORM:
+				nvgResetTransform(worker);
+				nvgTransform(worker, a[0], a[1], a[2], a[3], a[4], a[5]);
+				op = a + 6;
+				break;
+			case PATH_MOVETO:
+				nvgMoveTo(worker, a[0], a[1]);
+				op = a + 2;
+				break;
+			case PATH_LINETO:
+				nvgLineTo(worker, a[0], a[1]);
+				op = a + 2;
+				break;
+			case PATH_BEZIERTO:
+				nvgBezierTo(worker, a[0], a[1], a[2], a[3], a[4], a[5]);
+				op = a + 6;
+				break;
+			case PATH_POLYLINE: {
+				int n = a[0];
+				const float* p = a + 1;
+				nvgMoveTo(worker, p[0], p[1]);
+				for (int i=1; i<n; i++) {
+					nvgLineTo(worker, p[i*2], p[i*2+1]);
+				}
+				op = p + n*2;
+				break;
+			}
+			case PATH_RECT:
+				nvgRect(worker, a[0], a[1], a[2], a[3]);
+				op = a + 4;
+				break;
+			case PATH_ROUNDEDRECT:
+				nvgRoundedRect4(worker, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+				op = a + 8;
+				break;
+			case PATH_ELLIPSE:
+				nvgEllipse(worker, a[0], a[1], a[2], a[3]);
+				op = a + 4;
+				break;
+			case PATH_ARC:
+				nvgArc(worker, a[0], a[1], a[2], a[3], a[4], (int)a[5]);
+				op = a + 6;
+				break;
+			case PATH_WINDING:
+				nvgPathWinding(worker, (int)a[0]);
+				op = a + 1;
+				break;
+			default:
+				op = end;
+				break;
+		}
+	}
+
+	nvgResetTransform(worker);
+	nvgTransform(worker, path.xform[0], path.xform[1], path.xform[2], path.xform[3], path.xform[4], path.xform[5]);
+	if (path.stroke) {
+		nvgStroke(worker);
+	}
+	else {
+		nvgFill(worker);
+	}
+	scratch.capture = NULL;
+}
+
+void ofxNanoVG::drawDirect(const DirectStroke &stroke, const NVGvertex *verts)
+{
+	if (stroke.nverts == 0) {
+		return;
+	}
+
+	NVGpaint paint = stroke.paint;
+	float fringe = 1.0f / framePixRatio;
+	NVGparams* params = nvgInternalParams(ctx);
+	if (stroke.ramp) {
+		submitDirect(verts, stroke.nverts, stroke.scissor, [&](NVGscissor* s) {
+			if (trace) {
+				trace->directTriangles(paint, *s, verts, stroke.nverts);
+			}
+			params->renderTriangles(params->userPtr, &paint, s, verts, stroke.nverts);
+		});
+		return;
+	}
+
+	NVGpath path;
+	memset(&path, 0, sizeof(path));
+	path.closed = stroke.closed;
+	path.stroke = const_cast<NVGvertex*>(verts);
+	path.nstroke = stroke.nverts;
+	submitDirect(verts, stroke.nverts, stroke.scissor, [&](NVGscissor* s) {
+		if (trace) {
+			trace->directStroke(paint, *s, fringe, fringe, stroke.closed, verts, stroke.nverts);
+		}
+		params->renderStroke(params->userPtr, &paint, s, fringe, fringe, &path, 1);
+	});
+}
+
+// what nvgFill or nvgStroke would have handed to the backend
+void ofxNanoVG::drawQueuedPath(const QueuedPath &path)
+{
+	if (path.npaths == 0) {
+		return;
+	}
+
+	const ThreadScratch& scratch = threadScratch[path.thread];
+	submitPaths.resize(path.npaths);
+	size_t nverts = 0;
+	for (int i=0; i<path.npaths; i++) {
+		NVGpath& p = submitPaths[i];
+		p = scratch.paths[path.firstPath + i];
+		p.fill = p.nfill > 0 ? const_cast<NVGvertex*>(&scratch.verts[scratch.pathVerts[(path.firstPath + i)*2]]) : NULL;
+		p.stroke = p.nstroke > 0 ? const_cast<NVGvertex*>(&scratch.verts[scratch.pathVerts[(path.firstPath + i)*2 + 1]]) : NULL;
+		nverts += path.stroke ? p.nstroke : p.nfill + p.nstroke;
+	}
+	recordPathStats(&submitPaths[0], path.npaths, nverts, path.commands);
+
+	NVGpaint paint = path.paint;
+	NVGscissor s = path.scissor;
+	if (path.stroke) {
+		backendParams.renderStroke(backendParams.userPtr, &paint, &s, path.fringe, path.strokeWidth, &submitPaths[0], path.npaths);
+	}
+	else {
+		backendParams.renderFill(backendParams.userPtr, &paint, &s, path.fringe, path.bounds, &submitPaths[0], path.npaths);
+	}
+}
+
+/******
+ * Worker contexts
+ *
+ * Headless NanoVG contexts for the threads of the pool. They only
+ * tessellate: their backend keeps the paths and vertices of every fill and
+ * stroke in the thread's scratch and draws nothing.
+ */
+
+static int workerCreate(void* uptr) { return 1; }
+// nvgCreateInternal fails without its font atlas texture, which is never drawn
+static int workerCreateTexture(void* uptr, int type, int w, int h, int imageFlags, const unsigned char* data) { return 1; }
+static int workerDeleteTexture(void* uptr, int image) { return 1; }
+static int workerUpdateTexture(void* uptr, int image, int x, int y, int w, int h, const unsigned char* data) { return 1; }
+static int workerGetTextureSize(void* uptr, int image, int* w, int* h) { return 0; }
+static void workerViewport(void* uptr, int width, int height) {}
+static void workerCancel(void* uptr) {}
+static void workerFlush(void* uptr) {}
+static void workerTriangles(void* uptr, NVGpaint* paint, NVGscissor* scissor, const NVGvertex* verts, int nverts) {}
+static void workerDelete(void* uptr) {}
+
+// the missing ones; on failure the pool is cut to the calling thread
+bool ofxNanoVG::createWorkerContexts()
+{
+	for (ThreadScratch& scratch : threadScratch) {
+		if (scratch.ctx == NULL && !createWorkerContext(scratch)) {
+			ofLogError("ofxNanoVG") << "error creating worker contexts, drawing on the calling thread";
+			deleteWorkerContexts();
+			threadPool.setNumThreads(1);
+			threadScratch.resize(1);
+			return false;
+		}
+	}
+	return true;
 }
 
-void ofxNanoVG::fillEllipse(float cx, float cy, float rx, float ry, const ofColor& c) {
-	beginPath();
-	setFillColor(c);
-	ellipse(cx, cy, rx, ry);
-	fillPath();
+bool ofxNanoVG::createWorkerContext(ThreadScratch &scratch)
+{
+	NVGparams params;
+	memset(&params, 0, sizeof(params));
+	params.userPtr = &scratch;
+	params.edgeAntiAlias = (createFlags & NVG_ANTIALIAS) ? 1 : 0;
+	params.renderCreate = workerCreate;
+	params.renderCreateTexture = workerCreateTexture;
+	params.renderDeleteTexture = workerDeleteTexture;
+	params.renderUpdateTexture = workerUpdateTexture;
+	params.renderGetTextureSize = workerGetTextureSize;
+	params.renderViewport = workerViewport;
+	params.renderCancel = workerCancel;
+	params.renderFlush = workerFlush;
+	params.renderFill = captureFill;
+	params.renderStroke = captureStroke;
+	params.renderTriangles = workerTriangles;
+	params.renderDelete = workerDelete;
+
+	scratch.ctx = nvgCreateInternal(&params);
+	scratch.capture = NULL;
+	return scratch.ctx != NULL;
 }
 
-void ofxNanoVG::strokeCircle(float cx, float cy, float r, const ofColor& c, float width) {
-	beginPath();
-	setStrokeColor(c);
-	setStrokeWidth(width);
-	circle(cx, cy, r);
-	strokePath();
+void ofxNanoVG::deleteWorkerContexts()
+{
+	for (ThreadScratch& scratch : threadScratch) {
+		if (scratch.ctx != NULL) {
+			nvgDeleteInternal(scratch.ctx);
+			scratch.ctx = NULL;
+		}
+	}
 }
 
-void ofxNanoVG::fillCircle(float cx, float cy, float r, const ofColor& c) {
-	beginPath();
-	setFillColor(c);
-	circle(cx, cy, r);
-	fillPath();
+void ofxNanoVG::captureFill(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, const float* bounds, const NVGpath* paths, int npaths)
+{
+	ThreadScratch& scratch = *(ThreadScratch*)uptr;
+	capturePaths(scratch, paint, fringe, paths, npaths);
+	memcpy(scratch.capture->bounds, bounds, sizeof(scratch.capture->bounds));
 }
 
-void ofxNanoVG::strokeArc(float cx, float cy, float r, float a0, float a1, int dir, const ofColor& c, float width)
+void ofxNanoVG::captureStroke(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths)
 {
-	beginPath();
-	setStrokeColor(c);
-	setStrokeWidth(width);
-	arc(cx, cy, r, a0, a1, dir);
-	strokePath();
+	ThreadScratch& scratch = *(ThreadScratch*)uptr;
+	capturePaths(scratch, paint, fringe, paths, npaths);
+	scratch.capture->strokeWidth = strokeWidth;
 }
 
-void ofxNanoVG::fillArc(float cx, float cy, float r, float a0, float a1, int dir, const ofColor& c)
+// the vertices are copied, NanoVG reuses its buffers for the next path
+void ofxNanoVG::capturePaths(ThreadScratch &scratch, NVGpaint *paint, float fringe, const NVGpath *paths, int npaths)
 {
-	beginPath();
-	setFillColor(c);
-	arc(cx, cy, r, a0, a1, dir);
-	strokePath();
+	QueuedPath& path = *scratch.capture;
+	path.paint = *paint;
+	path.fringe = fringe;
+	path.firstPath = scratch.paths.size();
+	path.npaths = npaths;
+	for (int i=0; i<npaths; i++) {
+		scratch.paths.push_back(paths[i]);
+		scratch.pathVerts.push_back(scratch.verts.size());
+		scratch.verts.insert(scratch.verts.end(), paths[i].fill, paths[i].fill + paths[i].nfill);
+		scratch.pathVerts.push_back(scratch.verts.size());
+		scratch.verts.insert(scratch.verts.end(), paths[i].stroke, paths[i].stroke + paths[i].nstroke);
+	}
 }
 
-void ofxNanoVG::strokePolyline(const ofPolyline &line, const ofColor &c, float width) {
-	beginPath();
-	setStrokeColor(c);
-	setStrokeWidth(width);
-	followPolyline(line);
-	strokePath();
+// Hand geometry that bypasses NanoVG's path API to the backend with the
+// given scissor, or once per damage region it touches during partial redraw.
+void ofxNanoVG::submitDirect(const NVGvertex *verts, int nverts, const NVGscissor& scissor, const std::function<void (NVGscissor *)> &submit)
+{
+	if (!bDamageActive) {
+		NVGscissor s = scissor;
+		submit(&s);
+		return;
+	}
+
+	float bounds[4];
+	ofxNanoVGSimd::vertexBounds(verts, nverts, bounds);
+
+	// axis aligned bounds of the scissor, like nvgIntersectScissor
+	ofRectangle clip(0, 0, frameWidth, frameHeight);
+	if (scissor.extent[0] >= 0) {
+		float tex = scissor.extent[0]*fabsf(scissor.xform[0]) + scissor.extent[1]*fabsf(scissor.xform[2]);
+		float tey = scissor.extent[0]*fabsf(scissor.xform[1]) + scissor.extent[1]*fabsf(scissor.xform[3]);
+		clip = ofRectangle(scissor.xform[4]-tex, scissor.xform[5]-tey, tex*2, tey*2);
+	}
+
+	for (const ofRectangle& region : damageRegions) {
+		if (bounds[2] < region.x || bounds[0] > region.x+region.width || bounds[3] < region.y || bounds[1] > region.y+region.height) {
+			continue;
+		}
+		if (!region.intersects(clip)) {
+			continue;
+		}
+
+		ofRectangle r = region.getIntersection(clip);
+		NVGscissor s;
+		nvgTransformIdentity(s.xform);
+		s.xform[4] = r.x + r.width*0.5f;
+		s.xform[5] = r.y + r.height*0.5f;
+		s.extent[0] = r.width*0.5f;
+		s.extent[1] = r.height*0.5f;
+		submit(&s);
+	}
 }
 
+
 void ofxNanoVG::fillPolyline(const ofPolyline &line, const ofColor &c) {
 	beginPath();
 	setFillColor(c);
@@ -318,20 +2113,234 @@ void ofxNanoVG::fillPolyline(const ofPolyline &line, const ofColor &c) {
 	fillPath();
 }
 
+void ofxNanoVG::drawSprites(const ofTexture &atlas, const vector<ofRectangle> &dst, const vector<ofRectangle> &src, const vector<ofFloatColor> &tints, const vector<float> &rotations)
+{
+	if (!bInFrame || dst.empty()) {
+		return;
+	}
+
+	if (src.size() != dst.size()) {
+		ofLogError("ofxNanoVG::drawSprites") << "expected one source rect per sprite";
+		return;
+	}
+	if (tints.size() > 1 && tints.size() != dst.size()) {
+		ofLogError("ofxNanoVG::drawSprites") << "expected one tint per sprite, or a single tint";
+		return;
+	}
+	if (!rotations.empty() && rotations.size() != dst.size()) {
+		ofLogError("ofxNanoVG::drawSprites") << "expected one rotation per sprite";
+		return;
+	}
+
+	int image = getSpriteImage(atlas);
+	if (image <= 0) {
+		return;
+	}
+
+	// corners in local coordinates, transformed to frame coordinates in one go
+	int n = dst.size();
+	spritePoints.resize(n*8);
+	for (int i=0; i<n; i++) {
+		const ofRectangle& r = dst[i];
+		float* p = &spritePoints[i*8];
+		if (rotations.empty() || rotations[i] == 0) {
+			p[0] = r.x;				p[1] = r.y;
+			p[2] = r.x + r.width;	p[3] = r.y;
+			p[4] = r.x + r.width;	p[5] = r.y + r.height;
+			p[6] = r.x;				p[7] = r.y + r.height;
+			continue;
+		}
+
+		float cs = cosf(rotations[i]);
+		float sn = sinf(rotations[i]);
+		float cx = r.x + r.width*0.5f;
+		float cy = r.y + r.height*0.5f;
+		float hx = r.width*0.5f;
+		float hy = r.height*0.5f;
+		const float corners[8] = { -hx, -hy, hx, -hy, hx, hy, -hx, hy };
+		for (int k=0; k<4; k++) {
+			p[k*2] = cx + corners[k*2]*cs - corners[k*2+1]*sn;
+			p[k*2+1] = cy + corners[k*2]*sn + corners[k*2+1]*cs;
+		}
+	}
+	float xform[6];
+	nvgCurrentTransform(ctx, xform);
+	ofxNanoVGSimd::transformPoints(xform, &spritePoints[0], &spritePoints[0], n*4);
+
+	// two triangles per sprite
+	spriteVerts.resize(n*6);
+	for (int i=0; i<n; i++) {
+		const ofRectangle& r = src[i];
+		const float* p = &spritePoints[i*8];
+		ofPoint t0 = atlas.getCoordFromPoint(r.x, r.y);
+		ofPoint t1 = atlas.getCoordFromPoint(r.x + r.width, r.y + r.height);
+		NVGvertex v[4] = {
+			{ p[0], p[1], t0.x, t0.y },
+			{ p[2], p[3], t1.x, t0.y },
+			{ p[4], p[5], t1.x, t1.y },
+			{ p[6], p[7], t0.x, t1.y }
+		};
+		NVGvertex* out = &spriteVerts[i*6];
+		out[0] = v[0]; out[1] = v[1]; out[2] = v[2];
+		out[3] = v[0]; out[4] = v[2]; out[5] = v[3];
+	}
+
+	bool bMixedTints = false;
+	for (size_t i=1; i<tints.size() && !bMixedTints; i++) {
+		bMixedTints = !(tints[i] == tints[0]);
+	}
+	if (bMixedTints && scissor.extent[0] < 0 && trace == NULL && bakeState.bake == NULL) {
+		drawSpriteMesh(atlas, tints);
+		return;
+	}
+
+	NVGpaint paint = nvgImagePattern(ctx, 0, 0, 1, 1, 0, image, 1);
+	if (trace && !trace->hasImage(image)) {
+		trace->image(image, atlas.getWidth(), atlas.getHeight(), 0, NULL);
+	}
+
+	// one draw call per run of sprites with the same tint, in drawing order
+	NVGparams* params = nvgInternalParams(ctx);
+	for (int start=0; start<n; ) {
+		int end = start+1;
+		if (bMixedTints) {
+			const ofFloatColor& c = tints[start];
+			while (end < n && tints[end] == c) {
+				end++;
+			}
+		}
+		else {
+			end = n;
+		}
+
+		paint.innerColor = paint.outerColor = tints.empty() ? nvgRGBAf(1, 1, 1, 1) : toNVGcolor(tints[start]);
+		const NVGvertex* verts = &spriteVerts[start*6];
+		int nverts = (end-start)*6;
+		submitDirect(verts, nverts, scissor, [&](NVGscissor* s) {
+			if (trace) {
+				trace->directTriangles(paint, *s, verts, nverts);
+			}
+			params->renderTriangles(params->userPtr, &paint, s, verts, nverts);
+		});
+		spriteBatchCount++;
+		start = end;
+	}
+}
+
+// The sprites in spriteVerts with a tint each, drawn like drawBake draws
+// its mesh but in NanoVG's frame coordinates.
+void ofxNanoVG::drawSpriteMesh(const ofTexture &atlas, const vector<ofFloatColor> &tints)
+{
+	// flush starts NanoVG over from its default state, the caller's is set again after
+	float xform[6];
+	nvgCurrentTransform(ctx, xform);
+	NVGpaint fill = fillPaint;
+	NVGpaint stroke = strokePaint;
+	float width = strokeWidth;
+	int cap = lineCap;
+	int join = lineJoin;
+	int align = textAlign;
+	float blur = fontBlur;
+	flush();
+
+	int nverts = spriteVerts.size();
+	spriteMesh.setMode(OF_PRIMITIVE_TRIANGLES);
+	vector<ofVec3f>& verts = spriteMesh.getVertices();
+	vector<ofVec2f>& coords = spriteMesh.getTexCoords();
+	vector<ofFloatColor>& colors = spriteMesh.getColors();
+	verts.resize(nverts);
+	coords.resize(nverts);
+	colors.resize(nverts);
+	for (int i=0; i<nverts; i++) {
+		const NVGvertex& v = spriteVerts[i];
+		verts[i] = ofVec3f(v.x, v.y, 0);
+		coords[i] = ofVec2f(v.u, v.v);
+		colors[i] = tints[i/6];
+	}
+
+	ofPushView();
+	ofSetupScreenOrtho(frameWidth, frameHeight);
+	ofPushStyle();
+	ofEnableAlphaBlending();
+	atlas.bind();
+	if (!bDamageActive) {
+		spriteMesh.draw();
+	}
+	else {
+		glEnable(GL_SCISSOR_TEST);
+		for (const ofRectangle& r : damageRegions) {
+			glScissor(r.x*framePixRatio, (frameHeight - r.y - r.height)*framePixRatio, r.width*framePixRatio, r.height*framePixRatio);
+			spriteMesh.draw();
+		}
+		glDisable(GL_SCISSOR_TEST);
+	}
+	atlas.unbind();
+	ofPopStyle();
+	ofPopView();
+	spriteBatchCount++;
+
+	// the paints are already transformed, set them under the identity
+	nvgFillPaint(ctx, fill);
+	nvgStrokePaint(ctx, stroke);
+	fillPaint = fill;
+	strokePaint = stroke;
+	nvgStrokeWidth(ctx, width);
+	strokeWidth = width;
+	nvgLineCap(ctx, cap);
+	lineCap = cap;
+	nvgLineJoin(ctx, join);
+	lineJoin = join;
+	nvgTextAlign(ctx, align);
+	textAlign = align;
+	nvgFontBlur(ctx, blur);
+	fontBlur = blur;
+	nvgTransform(ctx, xform[0], xform[1], xform[2], xform[3], xform[4], xform[5]);
+}
+
+// One NanoVG image per texture (sprite atlas or getTexturePaint), created on
+// first use and kept until the context goes away or the texture changes size. The texture belongs to
+// the ofTexture, deleting the image leaves it alone.
+int ofxNanoVG::getSpriteImage(const ofTexture &atlas)
+{
+	const ofTextureData& data = atlas.getTextureData();
+	if (data.textureTarget != GL_TEXTURE_2D) {
+		ofLogError("ofxNanoVG") << "texture target should be GL_TEXTURE_2D";
+		return 0;
+	}
+
+	int w = atlas.getWidth();
+	int h = atlas.getHeight();
+	auto it = spriteImages.find(data.textureID);
+	if (it != spriteImages.end()) {
+		if (it->second.width == w && it->second.height == h) {
+			return it->second.image;
+		}
+		nvgDeleteImage(ctx, it->second.image);
+		spriteImages.erase(it);
+	}
+
+	int image = nvglCreateImageFromHandle(ctx, data.textureID, w, h, NVG_IMAGE_NODELETE);
+	if (image <= 0) {
+		ofLogError("ofxNanoVG") << "error uploading image to NanoVG";
+		return 0;
+	}
+
+	SpriteImage sprite;
+	sprite.image = image;
+	sprite.width = w;
+	sprite.height = h;
+	spriteImages[data.textureID] = sprite;
+	return image;
+}
+
 /******
  * Style
  */
 
 NVGpaint ofxNanoVG::getTexturePaint(const ofTexture& tex)
 {
-	if (tex.getTextureData().textureTarget != GL_TEXTURE_2D) {
-		ofLogError("ofxNanoVG") << "texture target should be GL_TEXTURE_2D";
-		return NVGpaint();
-	}
-	
-	int image = nvglCreateImageFromHandle(ctx, tex.getTextureData().textureID, tex.getWidth(), tex.getHeight(), 0);
+	int image = getSpriteImage(tex);
 	if (image <= 0) {
-		ofLogError("ofxNanoVG") << "error uploading image to NanoVG";
 		return NVGpaint();
 	}
 	
@@ -344,15 +2353,109 @@ NVGpaint ofxNanoVG::getTexturePaint(const ofTexture& tex)
 
 ofxNanoVG::Font* ofxNanoVG::addFont(const string &name, const string &filename)
 {
-	int fontId = nvgCreateFont(ctx, name.c_str(), ofToDataPath(filename).c_str());
+	for (Font* font : fonts) {
+		if (font->name == name && font->filename == filename && font->mapping) {
+			return font;
+		}
+	}
+
+	std::shared_ptr<ofxNanoVGFontMap> mapping = ofxNanoVGFontMap::open(filename);
+	if (!mapping || !isFontData(mapping->getData(), mapping->size())) {
+		ofLogError("ofxNanoVG::addFont", "could not create font %s from file: %s", name.c_str(), filename.c_str());
+		return NULL;
+	}
+
+	// freeData=0: the mapping is owned by the font
+	int fontId = nvgCreateFontMem(ctx, name.c_str(), const_cast<unsigned char*>(mapping->getData()), mapping->size(), 0);
 	if (fontId < 0) {
 		ofLogError("ofxNanoVG::addFont", "could not create font %s from file: %s", name.c_str(), filename.c_str());
 		return NULL;
 	}
 
+	Font* font = createFont(fontId, name);
+	font->filename = filename;
+	font->data = mapping->getData();
+	font->dataSize = mapping->size();
+	font->mapping = mapping;
+	return font;
+}
+
+ofxNanoVG::Font* ofxNanoVG::addFontMem(const string &name, const unsigned char *data, int size)
+{
+	if (!isFontData(data, size)) {
+		ofLogError("ofxNanoVG::addFontMem", "data for font %s is not a TrueType/OpenType font", name.c_str());
+		return NULL;
+	}
+
+	// freeData=0: nanovg reads the caller's buffer in place
+	int fontId = nvgCreateFontMem(ctx, name.c_str(), const_cast<unsigned char*>(data), size, 0);
+	if (fontId < 0) {
+		ofLogError("ofxNanoVG::addFontMem", "could not create font %s from memory", name.c_str());
+		return NULL;
+	}
+
+	Font* font = createFont(fontId, name);
+	font->data = data;
+	font->dataSize = size;
+	return font;
+}
+
+ofxNanoVG::Font* ofxNanoVG::addFontAsync(const string &name, const string &filename, std::function<void (Font *)> onReady)
+{
+	Font* font = createFont(-1, name);
+	font->filename = filename;
+
+	PendingFont pending;
+	pending.font = font;
+	pending.onReady = onReady;
+	string path = ofToDataPath(filename, true);
+	pending.data = std::async(std::launch::async, [path]() {
+		std::shared_ptr<ofxNanoVGFontMap> mapping = ofxNanoVGFontMap::open(path);
+		if (mapping && !isFontData(mapping->getData(), mapping->size())) {
+			mapping.reset();
+		}
+		return mapping;
+	});
+	pendingFonts.push_back(std::move(pending));
+
+	return font;
+}
+
+void ofxNanoVG::processFonts()
+{
+	for (auto it = pendingFonts.begin(); it != pendingFonts.end();) {
+		if (it->data.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			++it;
+			continue;
+		}
+
+		Font* font = it->font;
+		std::shared_ptr<ofxNanoVGFontMap> mapping = it->data.get();
+		if (mapping) {
+			font->data = mapping->getData();
+			font->dataSize = mapping->size();
+			font->id = nvgCreateFontMem(ctx, font->name.c_str(), const_cast<unsigned char*>(font->data), font->dataSize, 0);
+			font->mapping = mapping;
+		}
+		if (!font->isLoaded()) {
+			ofLogError("ofxNanoVG::addFontAsync", "could not create font %s from file: %s", font->name.c_str(), font->filename.c_str());
+		}
+
+		std::function<void(Font*)> onReady = it->onReady;
+		it = pendingFonts.erase(it);
+		if (onReady) {
+			onReady(font);
+		}
+	}
+}
+
+ofxNanoVG::Font* ofxNanoVG::createFont(int id, const string &name)
+{
 	Font* font = new Font();
-	font->id = fontId;
+	font->id = id;
 	font->name = name;
+	font->data = NULL;
+	font->dataSize = 0;
 	font->letterSpacing = 0;
 	font->lineHeight = 1.0f;
 	fonts.push_back(font);
@@ -360,6 +2463,20 @@ ofxNanoVG::Font* ofxNanoVG::addFont(const string &name, const string &filename)
 	return font;
 }
 
+// check for a TrueType, OpenType or font collection header
+bool ofxNanoVG::isFontData(const unsigned char *data, size_t size)
+{
+	if (data == NULL || size < 12) {
+		return false;
+	}
+
+	return (data[0] == 0 && data[1] == 1 && data[2] == 0 && data[3] == 0) ||
+		memcmp(data, "true", 4) == 0 ||
+		memcmp(data, "OTTO", 4) == 0 ||
+		memcmp(data, "ttcf", 4) == 0 ||
+		memcmp(data, "typ1", 4) == 0;
+}
+
 ofxNanoVG::Font* ofxNanoVG::getFont(const string &name)
 {
 	for (int i=0; i<fonts.size(); i++) {
@@ -389,10 +2506,45 @@ float ofxNanoVG::drawText(ofxNanoVG::Font *font, float x, float y, const string
 		return 0;
 	}
 
+	if (!font->isLoaded()) {
+		return x;
+	}
+
 	nvgFontFaceId(ctx, font->id);
 	nvgTextLetterSpacing(ctx, font->letterSpacing);
 	nvgFontSize(ctx, fontSize);
+	if (trace) {
+		traceTextState(font, fontSize, -1);
+	}
+
+	// partial redraw and picking are handled on the way
+	float endx;
+	if (drawAtlasText(font, fontSize, textAlign, x, y, text.c_str(), text.c_str()+text.size(), endx)) {
+		return endx;
+	}
+
+	if (bDamageActive || bRecordShapes) {
+		float bounds[4];
+		float endx = x + nvgTextBounds(ctx, x, y, text.c_str(), NULL, bounds);
+		if (bRecordShapes) {
+			recordBoxShape(bounds);
+		}
+		if (bDamageActive) {
+			resetPathBounds();
+			trackBox(bounds[0], bounds[1], bounds[2], bounds[3]);
+			drawInDamage(pathBounds, [&]() {
+				if (trace) {
+					traceOp()->text(x, y, text.c_str(), NULL);
+				}
+				endx = nvgText(ctx, x, y, text.c_str(), NULL);
+			});
+			return endx;
+		}
+	}
 
+	if (trace) {
+		traceOp()->text(x, y, text.c_str(), NULL);
+	}
 	return nvgText(ctx, x, y, text.c_str(), NULL);
 }
 
@@ -414,11 +2566,78 @@ void ofxNanoVG::drawTextBox(ofxNanoVG::Font *font, float x, float y, const strin
 		return;
 	}
 
+	if (!font->isLoaded()) {
+		return;
+	}
+
 	nvgFontFaceId(ctx, font->id);
 	nvgTextLetterSpacing(ctx, font->letterSpacing);
 	nvgTextLineHeight(ctx, lineHeight==-1?font->lineHeight:lineHeight);
 	nvgFontSize(ctx, fontSize);
+	if (trace) {
+		traceTextState(font, fontSize, lineHeight==-1?font->lineHeight:lineHeight);
+	}
+
+	if (bGlyphAtlas && trace == NULL && font->data != NULL) {
+		// same rows as nvgTextBox, each drawn from the atlas
+		if (boxMeasure == NULL) {
+			boxMeasure = new ofxNanoVGTextMeasure();
+			boxMeasure->setNumThreads(1);
+		}
+		// break the rows at the size drawAtlasText rasterizes them
+		float xform[6];
+		nvgCurrentTransform(ctx, xform);
+		boxMeasure->setPixelRatio(getFontScale(xform) * framePixRatio);
+
+		ofxNanoVGTextMeasure::Job job;
+		job.font = font;
+		job.fontSize = fontSize;
+		job.text = text;
+		job.x = x;
+		job.y = y;
+		job.breakRowWidth = breakRowWidth;
+		job.lineHeight = lineHeight;
+		job.align = textAlign;
+		ofxNanoVGTextMeasure::Result result = boxMeasure->measure(job);
+
+		int halign = textAlign & (NVG_ALIGN_LEFT | NVG_ALIGN_CENTER | NVG_ALIGN_RIGHT);
+		int valign = textAlign & (NVG_ALIGN_TOP | NVG_ALIGN_MIDDLE | NVG_ALIGN_BOTTOM | NVG_ALIGN_BASELINE);
+		for (const ofxNanoVGTextMeasure::Line& line : result.lines) {
+			float dx = 0;
+			if (halign & NVG_ALIGN_CENTER) {
+				dx = breakRowWidth*0.5f - line.width*0.5f;
+			}
+			else if (halign & NVG_ALIGN_RIGHT) {
+				dx = breakRowWidth - line.width;
+			}
+			float endx;
+			drawAtlasText(font, fontSize, NVG_ALIGN_LEFT | valign, x+dx, y+line.y, text.c_str()+line.start, text.c_str()+line.end, endx);
+		}
+		return;
+	}
+
+	if (bDamageActive || bRecordShapes) {
+		float bounds[4];
+		nvgTextBoxBounds(ctx, x, y, breakRowWidth, text.c_str(), NULL, bounds);
+		if (bRecordShapes) {
+			recordBoxShape(bounds);
+		}
+		if (bDamageActive) {
+			resetPathBounds();
+			trackBox(bounds[0], bounds[1], bounds[2], bounds[3]);
+			drawInDamage(pathBounds, [&]() {
+				if (trace) {
+					traceOp()->textBox(x, y, breakRowWidth, text.c_str(), NULL);
+				}
+				nvgTextBox(ctx, x, y, breakRowWidth, text.c_str(), NULL);
+			});
+			return;
+		}
+	}
 
+	if (trace) {
+		traceOp()->textBox(x, y, breakRowWidth, text.c_str(), NULL);
+	}
 	nvgTextBox(ctx, x, y, breakRowWidth, text.c_str(), NULL);
 }
 
@@ -429,16 +2648,42 @@ float ofxNanoVG::drawTextOnArc(const string &fontName, float cx, float cy, float
 		ofLogError("ofxNanoVG::drawTextOnArc", "cannot find font: %s", fontName.c_str());
 		return 0;
 	}
+
+	if (!font->isLoaded()) {
+		return 0;
+	}
 	
 	nvgFontFaceId(ctx, font->id);
 	nvgTextLetterSpacing(ctx, font->letterSpacing);
 	nvgTextLineHeight(ctx, font->lineHeight);
 	nvgFontSize(ctx, fontSize);
 	nvgTextAlign(ctx, NVG_ALIGN_LEFT | NVG_ALIGN_BASELINE);
+	textAlign = NVG_ALIGN_LEFT | NVG_ALIGN_BASELINE;
+	if (trace && !justMeasure) {
+		traceTextState(font, fontSize, font->lineHeight);
+		trace->textAlign(NVG_ALIGN_LEFT | NVG_ALIGN_BASELINE);
+	}
+
+	if (bDamageActive && !justMeasure) {
+		float reach = radius + fontSize*2;
+		resetPathBounds();
+		trackBox(cx-reach, cy-reach, cx+reach, cy+reach);
+		float arcBounds[4] = { pathBounds[0], pathBounds[1], pathBounds[2], pathBounds[3] };
+		float travel = 0;
+		bDamageActive = false;
+		drawInDamage(arcBounds, [&]() {
+			travel = drawTextOnArc(fontName, cx, cy, radius, startAng, dir, spacing, text, fontSize);
+		});
+		bDamageActive = true;
+		return travel;
+	}
 
 	float bounds[4];
 	nvgSave(ctx);
 	nvgTranslate(ctx, cx, cy);
+	if (trace && !justMeasure) {
+		trace->save();
+	}
 	float angle=startAng;
 	for (int i=0; i<text.length(); i++) {
 		if (text[i] == ' ') {
@@ -455,18 +2700,28 @@ float ofxNanoVG::drawTextOnArc(const string &fontName, float cx, float cy, float
 			nvgSave(ctx);
 			nvgRotate(ctx, ofDegToRad((angle+(bounds[2]/2/radius)) + ((dir==-1)?180:0)));
 			nvgTranslate(ctx, 0, (dir==1)?-radius:radius);
+			if (trace) {
+				traceOp()->text(0, 0, text.c_str()+i, text.c_str()+i+1);
+			}
 			nvgText(ctx, 0, 0, text.c_str()+i, text.c_str()+i+1);
 			nvgRestore(ctx);
 		}
 		angle += ((dir==1)?1:-1)*ofRadToDeg((bounds[2]+spacing)/radius);
 	}
 	nvgRestore(ctx);
+	if (trace && !justMeasure) {
+		trace->restore();
+	}
 	return angle-startAng;
 }
 
 void ofxNanoVG::setTextAlign(enum TextHorizontalAlign hor, enum TextVerticalAlign ver)
 {
 	nvgTextAlign(ctx, hor | ver);
+	textAlign = hor | ver;
+	if (trace) {
+		trace->textAlign(hor | ver);
+	}
 }
 
 ofRectangle ofxNanoVG::getTextBounds(const string &fontName, float x, float y, const string &text, float fontSize)
@@ -486,6 +2741,9 @@ ofRectangle ofxNanoVG::getTextBounds(ofxNanoVG::Font *font, float x, float y, co
 		ofLogError("ofxNanoVG::getTextBounds", "font == NULL");
 		return ofRectangle();
 	}
+	if (!font->isLoaded()) {
+		return ofRectangle();
+	}
 
 	nvgFontFaceId(ctx, font->id);
 	nvgTextLetterSpacing(ctx, font->letterSpacing);
@@ -514,6 +2772,9 @@ ofRectangle ofxNanoVG::getTextBoxBounds(ofxNanoVG::Font *font, float x, float y,
 		ofLogError("ofxNanoVG::getTextBoxBounds", "font == NULL");
 		return ofRectangle();
 	}
+	if (!font->isLoaded()) {
+		return ofRectangle();
+	}
 
 	nvgFontFaceId(ctx, font->id);
 	nvgTextLetterSpacing(ctx, font->letterSpacing);
@@ -530,6 +2791,130 @@ ofRectangle ofxNanoVG::getTextBoxBounds(ofxNanoVG::Font *font, float x, float y,
 void ofxNanoVG::setFontBlur(float blur)
 {
 	nvgFontBlur(ctx, blur);
+	fontBlur = blur;
+	if (trace) {
+		trace->fontBlur(blur);
+	}
+}
+
+void ofxNanoVG::setGlyphAtlas(bool enable, size_t budget, int pageSize)
+{
+	if (bInFrame) {
+		ofLogError("ofxNanoVG") << "setGlyphAtlas was called while in a frame";
+		return;
+	}
+
+	bGlyphAtlas = enable;
+	glyphAtlasBudget = budget;
+	glyphAtlasPageSize = pageSize;
+	if (!enable) {
+		glyphAtlas.clear();
+	}
+	else if (ctx != NULL) {
+		glyphAtlas.setup(ctx, budget, pageSize);
+	}
+}
+
+// Draw a line of text like nvgText does, from the glyph atlas. Returns false
+// when it has to go through NanoVG instead.
+bool ofxNanoVG::drawAtlasText(Font *font, float fontSize, int align, float x, float y, const char *str, const char *end, float &endx)
+{
+	if (!bGlyphAtlas || trace != NULL || font->data == NULL) {
+		return false;
+	}
+
+	float xform[6];
+	nvgCurrentTransform(ctx, xform);
+	float scale = getFontScale(xform) * framePixRatio;
+	float invscale = 1.0f / scale;
+
+	ofxNanoVGGlyphAtlas::TextStyle style;
+	style.fontData = font->data;
+	style.fontDataSize = font->dataSize;
+	style.size = fontSize*scale;
+	style.spacing = font->letterSpacing*scale;
+	style.blur = fontBlur*scale;
+	style.align = align;
+
+	glyphVerts.clear();
+	glyphImages.clear();
+	endx = glyphAtlas.layout(style, x*scale, y*scale, str, end, glyphVerts, glyphImages) * invscale;
+	if (glyphVerts.empty()) {
+		return true;
+	}
+
+	// font pixels to local coordinates, then to frame coordinates
+	float bounds[4] = { glyphVerts[0].x*invscale, glyphVerts[0].y*invscale, glyphVerts[0].x*invscale, glyphVerts[0].y*invscale };
+	for (NVGvertex& v : glyphVerts) {
+		float lx = v.x*invscale;
+		float ly = v.y*invscale;
+		bounds[0] = min(bounds[0], lx);
+		bounds[1] = min(bounds[1], ly);
+		bounds[2] = max(bounds[2], lx);
+		bounds[3] = max(bounds[3], ly);
+		nvgTransformPoint(&v.x, &v.y, xform, lx, ly);
+	}
+	if (bRecordShapes) {
+		recordBoxShape(bounds);
+	}
+
+	// one draw call per page, glyphs keep their order within a page
+	int nglyphs = glyphImages.size();
+	const NVGvertex* verts = &glyphVerts[0];
+	if (std::count(glyphImages.begin(), glyphImages.end(), glyphImages[0]) != nglyphs) {
+		glyphOrder.resize(nglyphs);
+		for (int i=0; i<nglyphs; i++) {
+			glyphOrder[i] = i;
+		}
+		std::stable_sort(glyphOrder.begin(), glyphOrder.end(), [this](int a, int b) {
+			return glyphImages[a] < glyphImages[b];
+		});
+		glyphBatch.resize(glyphVerts.size());
+		for (int i=0; i<nglyphs; i++) {
+			std::copy(&glyphVerts[glyphOrder[i]*6], &glyphVerts[glyphOrder[i]*6] + 6, &glyphBatch[i*6]);
+		}
+		verts = &glyphBatch[0];
+	}
+	else {
+		glyphOrder.assign(nglyphs, 0);
+	}
+
+	NVGparams* params = nvgInternalParams(ctx);
+	for (int start=0; start<nglyphs; ) {
+		int image = glyphImages[glyphOrder[start]];
+		int count = 1;
+		while (start+count < nglyphs && glyphImages[glyphOrder[start+count]] == image) {
+			count++;
+		}
+
+		// what nvg__renderText does with the fill paint
+		NVGpaint paint = fillPaint;
+		paint.image = image;
+		const NVGvertex* batch = verts + start*6;
+		submitDirect(batch, count*6, scissor, [&](NVGscissor* s) {
+			params->renderTriangles(params->userPtr, &paint, s, batch, count*6);
+		});
+		start += count;
+	}
+
+	return true;
+}
+
+void ofxNanoVG::resetTextState()
+{
+	setColorPaint(fillPaint, nvgRGBA(255, 255, 255, 255));
+	textAlign = NVG_ALIGN_LEFT | NVG_ALIGN_BASELINE;
+	fontBlur = 0;
+}
+
+// same as nvg__setPaintColor
+void ofxNanoVG::setColorPaint(NVGpaint &paint, const NVGcolor &c)
+{
+	memset(&paint, 0, sizeof(paint));
+	nvgTransformIdentity(paint.xform);
+	paint.feather = 1.0f;
+	paint.innerColor = c;
+	paint.outerColor = c;
 }
 
 
@@ -647,6 +3032,22 @@ void ofxNanoVG::enableScissor(float x, float y, float w, float h)
 	}
 
 	nvgScissor(ctx, x, y, w, h);
+	bScissor = true;
+	if (trace) {
+		traceOp()->scissor(x, y, w, h);
+	}
+
+	// same as nvgScissor
+	float xform[6];
+	nvgCurrentTransform(ctx, xform);
+	w = max(0.0f, w);
+	h = max(0.0f, h);
+	nvgTransformIdentity(scissor.xform);
+	scissor.xform[4] = x+w*0.5f;
+	scissor.xform[5] = y+h*0.5f;
+	nvgTransformMultiply(scissor.xform, xform);
+	scissor.extent[0] = w*0.5f;
+	scissor.extent[1] = h*0.5f;
 }
 
 void ofxNanoVG::disableScissor()
@@ -656,6 +3057,27 @@ void ofxNanoVG::disableScissor()
 	}
 
 	nvgResetScissor(ctx);
+	resetScissorState();
+	if (trace) {
+		trace->resetScissor();
+	}
+}
+
+// same as nvgReset
+void ofxNanoVG::resetStyleState()
+{
+	strokeWidth = 1;
+	lineCap = NVG_BUTT;
+	lineJoin = NVG_MITER;
+	setColorPaint(strokePaint, nvgRGBA(0, 0, 0, 255));
+}
+
+void ofxNanoVG::resetScissorState()
+{
+	bScissor = false;
+	memset(scissor.xform, 0, sizeof(scissor.xform));
+	scissor.extent[0] = -1.0f;
+	scissor.extent[1] = -1.0f;
 }
 
 //------------------------------------------------------------------
@@ -669,17 +3091,25 @@ void ofxNanoVG::applyOFStyle()
 	NVGcolor color = toNVGcolor(style.color);
 
 	nvgFillColor(ctx, color);
+	setColorPaint(fillPaint, color);
 	nvgStrokeColor(ctx, color);
+	setColorPaint(strokePaint, color);
 	nvgStrokeWidth(ctx, style.lineWidth);
+	strokeWidth = style.lineWidth;
+	if (trace) {
+		trace->fillColor(color);
+		trace->strokeColor(color);
+		trace->strokeWidth(style.lineWidth);
+	}
 }
 
 void ofxNanoVG::doOFDraw()
 {
 	ofStyle style = ofGetStyle();
 	if (style.bFill) {
-		nvgFill(ctx);
+		fillPath();
 	}
 	else {
-		nvgStroke(ctx);
+		strokePath();
 	}
 }
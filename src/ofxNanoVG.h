@@ -10,9 +10,19 @@
 #define __sentopiary__ofxNanoVG__
 
 #include <stdio.h>
+#include <future>
+#include <unordered_map>
 #include "ofMain.h"
 #include "nanosvg.h"
 #include "nanovg.h"
+#include "ofxNanoVGFontMap.h"
+#include "ofxNanoVGShapeIndex.h"
+#include "ofxNanoVGTrace.h"
+#include "ofxNanoVGThreadPool.h"
+#include "ofxNanoVGGlyphAtlas.h"
+#include "ofxNanoVGBake.h"
+
+class ofxNanoVGTextMeasure;
 
 class ofxNanoVG
 {
@@ -26,12 +36,37 @@ public:
 		return instance;
 	}
 
+	// Expected sizes used to pre-grow NanoVG's buffers in setup, so that the
+	// first heavy frames don't reallocate. Commands (floats) and points are
+	// kept per path, vertices per frame. 0 keeps NanoVG's defaults.
+	struct BufferSettings {
+		BufferSettings(int commands=0, int points=0, int vertices=0) :
+			commands(commands), points(points), vertices(vertices) {}
+		int commands;
+		int points;
+		int vertices;
+	};
+
 	void setup(bool stencilStrokes=false, bool debug=false);
+	// threads tessellate fills and strokes. With 1 (the default) everything
+	// is drawn right away on the calling thread, 0 uses one per core. With
+	// more than one, fills and strokes are queued and each path is replayed
+	// into a worker context of the thread that tessellates it, then its
+	// vertices are copied to the backend: this costs a second pass over the
+	// path and only pays off with many long paths per frame. Only the calls
+	// made through ofxNanoVG are replayed, state and paths set on
+	// getContext() directly aren't seen by the workers.
+	void setup(bool stencilStrokes, bool debug, const BufferSettings& buffers, int threads=1);
+	// outside a frame
+	void setNumThreads(int threads);
+	int getNumThreads() const { return threadPool.getNumThreads(); }
 
 	struct Settings {
 		int width;
 		int height;
 		float devicePixelRatio;
+		bool damageActive;
+		bool recordShapes;
 	};
 
 	void beginFrame(int width, int height, float devicePixelRatio);
@@ -41,6 +76,119 @@ public:
 	void popFrame();
 	std::stack<Settings> framesStack;
 
+	// drop everything drawn since beginFrame and start the frame over,
+	// reusing the memory it has already grown to
+	void resetFrame();
+
+	/******
+	 * Memory
+	 *
+	 * NanoVG never shrinks its buffers, so the high-water mark is also what
+	 * stays allocated. Commands are counted as issued through ofxNanoVG.
+	 */
+	struct BufferStats {
+		size_t current;		// bytes used by the last path / frame
+		size_t highWater;	// most bytes used since setup or trim
+	};
+	struct MemoryStats {
+		BufferStats commands;		// path commands, per path
+		BufferStats points;			// flattened points, per path
+		BufferStats paths;			// sub-paths, per path
+		BufferStats vertices;		// tessellated vertices, per fill/stroke
+		BufferStats frameVertices;	// vertices queued for the GPU, per frame
+	};
+	const MemoryStats& getMemoryStats() const { return memStats; }
+
+	// give back memory held after a peak by recreating the NanoVG context.
+	// Fonts are reloaded, images from getTexturePaint become invalid.
+	void trim();
+	// times trim recreated the context. When it changes, paints and image ids
+	// kept from before are invalid and getTexturePaint must be called again.
+	int getTrimCount() const { return trimCount; }
+
+	/******
+	 * Partial redraw
+	 *
+	 * When enabled, only the damage rectangles (in frame coordinates) added
+	 * since the last frame are repainted. They are merged into at most
+	 * maxDamageRegions regions on beginFrame; fills, strokes and text outside
+	 * the regions are skipped and the rest are scissored to them.
+	 * Pixels outside the regions are left as they are, so the target must not
+	 * be cleared (draw into an FBO or use ofSetBackgroundAuto(false)).
+	 */
+	void setPartialRedraw(bool enable);
+	bool isPartialRedraw() const { return bPartialRedraw; }
+	void addDamageRect(float x, float y, float w, float h);
+	inline void addDamageRect(const ofRectangle& r) { addDamageRect(r.x, r.y, r.width, r.height); }
+	// repaint the whole frame next time (e.g. after a resize)
+	void damageAll();
+	void setMaxDamageRegions(int count);
+	// outline the repainted regions at endFrame
+	void setDamageDebug(bool debug);
+	// regions repainted in the current frame, empty on a full redraw
+	const vector<ofRectangle>& getDamageRegions() const { return damageRegions; }
+
+	/******
+	 * Picking
+	 *
+	 * While enabled, fills, strokes and text drawn with a shape id other than
+	 * -1 are recorded (flattened, in frame coordinates) and indexed at
+	 * endFrame. pick() queries the last finished frame, so it can be called
+	 * from input handlers between frames.
+	 */
+	void setPicking(bool enable) { bPicking = enable; }
+	bool isPicking() const { return bPicking; }
+	// id for the shapes drawn from now on, -1 to stop recording them
+	void setShapeId(int id) { shapeId = id; }
+	int getShapeId() const { return shapeId; }
+	// id of the topmost shape at x, y (frame coordinates) or -1
+	int pick(float x, float y) const { return pickIndex.pick(x, y); }
+	const ofxNanoVGShapeIndex& getShapeIndex() const { return pickIndex; }
+	// extra distance (frame pixels) around strokes that still picks them,
+	// for the shapes drawn from now on
+	void setPickStrokeTolerance(float tolerance) {
+		frameShapes.setStrokeTolerance(tolerance);
+		pickIndex.setStrokeTolerance(tolerance);
+	}
+
+	/******
+	 * Tracing
+	 *
+	 * Stream every call ofxNanoVG makes into NanoVG during the next frames to
+	 * a binary trace file, to reproduce and profile a frame outside the app
+	 * with ofxNanoVGTracePlayer. Calls made on the NanoVG context directly
+	 * are not traced.
+	 */
+	// frames: top level frames to capture starting with the next one, -1 until endTrace
+	bool beginTrace(const string& filename, int frames=1);
+	// when called inside a frame, the trace ends with that frame
+	void endTrace();
+	bool isTracing() const { return traceWriter.isOpen(); }
+	NVGcontext* getContext() const { return ctx; }
+	// the backend's callbacks, called for everything that reaches it (also
+	// the queued paths). Swapping one, and calling the old one from it,
+	// observes the draws; the context's own callbacks are ofxNanoVG's hooks.
+	// Reset when the context is recreated (see trim).
+	NVGparams& getBackendParams() { return backendParams; }
+
+	/******
+	 * Baking
+	 *
+	 * Fills and strokes drawn between beginBake and endBake (inside a frame)
+	 * are tessellated by NanoVG as usual but added to bake instead of being
+	 * drawn, so static artwork can be drawn again from the mesh without
+	 * tessellating, or saved and loaded with it. Only draws in a solid color
+	 * and outside a scissor are baked, see ofxNanoVGBake. Partial redraw,
+	 * picking and tracing are suspended meanwhile.
+	 */
+	void beginBake(ofxNanoVGBake& bake);
+	void endBake();
+	bool isBaking() const { return bakeState.bake != NULL; }
+	// inside a frame NanoVG's draws so far are flushed first (see flush), then
+	// the mesh is drawn with the current OF transform and clipped to the
+	// damage regions during partial redraw
+	void drawBake(const ofxNanoVGBake& bake);
+
 	/******
 	 * Shapes
 	 */
@@ -55,13 +203,42 @@ public:
 	// lineCap: one of: NVG_BUTT (default), NVG_ROUND, NVG_SQUARE
 	// lineJoin: one of: NVG_MITER (default), NVG_ROUND, NVG_BEVEL
 
+	enum PathWinding {
+		NVG_SOLID = 1,
+		NVG_HOLE = 2
+	};
+
 	// must call beginPath before drawing
 	inline void beginPath() {
 		nvgBeginPath(ctx);
+		pathCommands = 0;
+		resetPathBounds();
+		beginPathOps();
+		if (trace) {
+			trace->beginPath();
+		}
+		if (bRecordShapes) {
+			pathPoints.clear();
+			pathContours.clear();
+		}
 	}
 	
 	// call fillPath or strokePath after drawing with the functions below to fill/stroke the path
 	inline void strokePath() {
+		if (bRecordShapes) {
+			recordShape(true);
+		}
+		if (bDamageActive) {
+			drawDamaged(true);
+			return;
+		}
+		if (trace) {
+			traceOp()->stroke();
+		}
+		if (canQueuePath()) {
+			queuePath(true);
+			return;
+		}
 		nvgStroke(ctx);
 	}
 	inline void strokePath(const ofColor& c) {
@@ -70,6 +247,20 @@ public:
 	}
 	
 	inline void fillPath() {
+		if (bRecordShapes) {
+			recordShape(false);
+		}
+		if (bDamageActive) {
+			drawDamaged(false);
+			return;
+		}
+		if (trace) {
+			trace->fill();
+		}
+		if (canQueuePath()) {
+			queuePath(false);
+			return;
+		}
 		nvgFill(ctx);
 	}
 	inline void fillPath(const ofColor& c) {
@@ -80,51 +271,194 @@ public:
 	inline void rect(const ofRectangle& r) { rect(r.x, r.y, r.width, r.height); }
 	inline void rect(float x, float y, float w, float h) {
 		nvgRect(ctx, x, y, w, h);
+		if (trace) {
+			traceOp()->rect(x, y, w, h);
+		}
+		pathCommands += CMD_RECT;
+		trackBox(x, y, x+w, y+h);
+		if (bRecordShapes) {
+			recordRoundedRect(x, y, w, h, 0, 0, 0, 0);
+		}
+		if (bPathOps) {
+			const float args[] = { x, y, w, h };
+			addPathOp(PATH_RECT, args, 4);
+		}
 	}
 	
 	inline void roundedRect(const ofRectangle &r, float ang) { roundedRect(r.x, r.y, r.width, r.height, ang); }
 	inline void roundedRect(float x, float y, float w, float h, float r) {
 		nvgRoundedRect(ctx, x, y, w, h, r);
+		if (trace) {
+			traceOp()->roundedRect(x, y, w, h, r, r, r, r);
+		}
+		pathCommands += r < 0.1f ? CMD_RECT : CMD_ROUNDEDRECT;
+		trackBox(x, y, x+w, y+h);
+		if (bRecordShapes) {
+			recordRoundedRect(x, y, w, h, r, r, r, r);
+		}
+		if (bPathOps) {
+			const float args[] = { x, y, w, h, r, r, r, r };
+			addPathOp(PATH_ROUNDEDRECT, args, 8);
+		}
 	}
 	inline void roundedRect(const ofRectangle &r, float ang_tl, float ang_tr, float ang_br, float ang_bl) { roundedRect(r.x, r.y, r.width, r.height, ang_tl, ang_tr, ang_br, ang_bl); }
 	inline void roundedRect(float x, float y, float w, float h, float r_tl, float r_tr, float r_br, float r_bl) {
 		nvgRoundedRect4(ctx, x, y, w, h, r_tl, r_tr, r_br, r_bl);
+		if (trace) {
+			traceOp()->roundedRect(x, y, w, h, r_tl, r_tr, r_br, r_bl);
+		}
+		pathCommands += CMD_ROUNDEDRECT;
+		trackBox(x, y, x+w, y+h);
+		if (bRecordShapes) {
+			recordRoundedRect(x, y, w, h, r_tl, r_tr, r_br, r_bl);
+		}
+		if (bPathOps) {
+			const float args[] = { x, y, w, h, r_tl, r_tr, r_br, r_bl };
+			addPathOp(PATH_ROUNDEDRECT, args, 8);
+		}
 	}
 
 	inline void ellipse(const ofVec2f& p, float rx, float ry) { ellipse(p.x, p.y, rx, ry); }
 	inline void ellipse(float cx, float cy, float rx, float ry) {
 		nvgEllipse(ctx, cx, cy, rx, ry);
+		if (trace) {
+			traceOp()->ellipse(cx, cy, rx, ry);
+		}
+		pathCommands += CMD_ELLIPSE;
+		trackBox(cx-rx, cy-ry, cx+rx, cy+ry);
+		if (bRecordShapes) {
+			recordEllipse(cx, cy, rx, ry);
+		}
+		if (bPathOps) {
+			const float args[] = { cx, cy, rx, ry };
+			addPathOp(PATH_ELLIPSE, args, 4);
+		}
 	}
 	
 	inline void circle(const ofVec2f& p, float r) { circle(p.x, p.y, r); }
 	inline void circle(float cx, float cy, float r) {
 		nvgCircle(ctx, cx, cy, r);
+		if (trace) {
+			traceOp()->ellipse(cx, cy, r, r);
+		}
+		pathCommands += CMD_ELLIPSE;
+		trackBox(cx-r, cy-r, cx+r, cy+r);
+		if (bRecordShapes) {
+			recordEllipse(cx, cy, r, r);
+		}
+		if (bPathOps) {
+			const float args[] = { cx, cy, r, r };
+			addPathOp(PATH_ELLIPSE, args, 4);
+		}
 	}
 	
 	inline void arc(const ofVec2f& p, float r, float a0, float a1, int dir) { arc(p.x, p.y, r, a0, a1, dir); }
 	inline void arc(float cx, float cy, float r, float a0, float a1, int dir) {
 		nvgArc(ctx, cx, cy, r, ofDegToRad(a0-90), ofDegToRad(a1-90), dir);
+		if (trace) {
+			traceOp()->arc(cx, cy, r, ofDegToRad(a0-90), ofDegToRad(a1-90), dir);
+		}
+		pathCommands += getArcCommands(ofDegToRad(a0-90), ofDegToRad(a1-90), dir);
+		trackBox(cx-r, cy-r, cx+r, cy+r);
+		if (bRecordShapes) {
+			recordArc(cx, cy, r, ofDegToRad(a0-90), ofDegToRad(a1-90), dir);
+		}
+		if (bPathOps) {
+			const float args[] = { cx, cy, r, ofDegToRad(a0-90), ofDegToRad(a1-90), (float)dir };
+			addPathOp(PATH_ARC, args, 6);
+		}
 	}
 
 	inline void line(const ofVec2f& p1, const ofVec2f& p2) { line(p1.x, p1.y, p2.x, p2.y); }
 	inline void line(float x1, float y1, float x2, float y2) {
 		nvgMoveTo(ctx, x1, y1);
 		nvgLineTo(ctx, x2, y2);
+		if (trace) {
+			traceOp()->moveTo(x1, y1);
+			trace->lineTo(x2, y2);
+		}
+		pathCommands += CMD_MOVETO + CMD_LINETO;
+		trackPoint(x1, y1);
+		trackPoint(x2, y2);
+		if (bRecordShapes) {
+			recordMoveTo(x1, y1);
+			recordLineTo(x2, y2);
+		}
+		if (bPathOps) {
+			const float args[] = { x1, y1, x2, y2 };
+			addPathOp(PATH_MOVETO, args, 2);
+			addPathOp(PATH_LINETO, args+2, 2);
+		}
 	}
 	
 	inline void moveTo(const ofVec2f& p) { moveTo(p.x, p.y); }
 	inline void moveTo(float x, float y) {
 		nvgMoveTo(ctx, x, y);
+		if (trace) {
+			traceOp()->moveTo(x, y);
+		}
+		pathCommands += CMD_MOVETO;
+		trackPoint(x, y);
+		if (bRecordShapes) {
+			recordMoveTo(x, y);
+		}
+		if (bPathOps) {
+			const float args[] = { x, y };
+			addPathOp(PATH_MOVETO, args, 2);
+		}
 	}
 	
 	inline void lineTo(const ofVec2f& p) { lineTo(p.x, p.y); }
 	inline void lineTo(float x, float y) {
 		nvgLineTo(ctx, x, y);
+		if (trace) {
+			traceOp()->lineTo(x, y);
+		}
+		pathCommands += CMD_LINETO;
+		trackPoint(x, y);
+		if (bRecordShapes) {
+			recordLineTo(x, y);
+		}
+		if (bPathOps) {
+			const float args[] = { x, y };
+			addPathOp(PATH_LINETO, args, 2);
+		}
 	}
 	
 	inline void bezierTo(const ofVec2f& cp1, const ofVec2f& cp2, const ofVec2f& dst) { bezierTo(cp1.x, cp1.y, cp2.x, cp2.y, dst.x, dst.y); }
 	inline void bezierTo(float cx1, float cy1, float cx2, float cy2, float x, float y) {
 		nvgBezierTo(ctx, cx1, cy1, cx2, cy2, x, y);
+		if (trace) {
+			traceOp()->bezierTo(cx1, cy1, cx2, cy2, x, y);
+		}
+		pathCommands += CMD_BEZIERTO;
+		trackPoint(cx1, cy1);
+		trackPoint(cx2, cy2);
+		trackPoint(x, y);
+		if (bRecordShapes) {
+			recordBezierTo(cx1, cy1, cx2, cy2, x, y);
+		}
+		if (bPathOps) {
+			const float args[] = { cx1, cy1, cx2, cy2, x, y };
+			addPathOp(PATH_BEZIERTO, args, 6);
+		}
+	}
+
+	// marks the sub-path just started (moveTo, rect, ellipse...) as NVG_SOLID
+	// (default) or NVG_HOLE; fills turn solid sub-paths and holes opposite ways
+	inline void pathWinding(enum PathWinding winding) {
+		nvgPathWinding(ctx, winding);
+		if (trace) {
+			trace->pathWinding(winding);
+		}
+		pathCommands += CMD_WINDING;
+		if (bRecordShapes && !pathContours.empty()) {
+			pathContours.back().hole = winding == NVG_HOLE;
+		}
+		if (bPathOps) {
+			const float args[] = { (float)winding };
+			addPathOp(PATH_WINDING, args, 1);
+		}
 	}
 	
 	void followPolyline(const ofPolyline& line);
@@ -166,43 +500,109 @@ public:
 	void strokeArc(float cx, float cy, float r, float a0, float a1, int dir, const ofColor& c, float width=1);
 	void fillArc(float cx, float cy, float r, float a0, float a1, int dir, const ofColor& c);
 	void strokePolyline(const ofPolyline& line, const ofColor& c, float width=1);
+	// stroke with a color per vertex, interpolated along the line, as one draw call.
+	// The colors are looked up in a texture of at most 4096 texels, lines with
+	// more vertices are resampled to that and lose detail finer than that.
+	void strokePolyline(const ofPolyline& line, const vector<ofFloatColor>& colors, float width=1);
+	// stroke with each vertex colored by its value mapped from [minValue, maxValue]
+	// onto ramp (also resampled to 4096 colors at most)
+	void strokePolyline(const ofPolyline& line, const vector<float>& values, const vector<ofFloatColor>& ramp, float minValue, float maxValue, float width=1);
+
+	// strokeLine, strokeRect and strokePolyline that end up no wider than one
+	// device pixel skip NanoVG's stroke expansion and are drawn as a single
+	// anti-aliased strip (enabled by default). The strip always has butt caps
+	// and no joins, setLineCap and setLineJoin don't apply to it.
+	void setHairlineFastPath(bool enable) { bHairlineFastPath = enable; }
+	// strokes drawn through the hairline fast path in the current frame
+	int getHairlineStrokeCount() const { return hairlineCount; }
 	void fillPolyline(const ofPolyline& line, const ofColor& c);
+
+	// draw sprites from one GL_TEXTURE_2D atlas as a single batch of textured
+	// triangles, in order. dst are rects in local coordinates, src the
+	// matching rects in atlas pixels. tints multiply the texture (one per
+	// sprite, one for all, or none for white). rotations are optional, in
+	// radians about each dst center.
+	// With a single tint the batch is one NanoVG draw call. NanoVG's vertices
+	// have no color, so sprites with different tints are drawn by OF as one
+	// mesh with the tints as vertex colors, after NanoVG's draws so far are
+	// flushed (see flush; the transform and style are kept). Inside a
+	// scissor, while tracing or baking they are one NanoVG draw call per run
+	// of consecutive sprites with the same tint instead.
+	void drawSprites(const ofTexture& atlas, const vector<ofRectangle>& dst, const vector<ofRectangle>& src, const vector<ofFloatColor>& tints=vector<ofFloatColor>(), const vector<float>& rotations=vector<float>());
+	// draw calls made by drawSprites in the current frame
+	int getSpriteBatchCount() const { return spriteBatchCount; }
 	
 	/******
 	 * Style
 	 */
 	inline void setStrokeWidth(float width) {
 		nvgStrokeWidth(ctx, width);
+		strokeWidth = width;
+		if (trace) {
+			trace->strokeWidth(width);
+		}
 	}
 	
 	inline void setLineCap(enum LineParam cap) {
 		nvgLineCap(ctx, cap);
+		lineCap = cap;
+		if (trace) {
+			trace->lineCap(cap);
+		}
 	}
 	
 	inline void setLineJoin(enum LineParam join) {
 		nvgLineJoin(ctx, join);
+		lineJoin = join;
+		if (trace) {
+			trace->lineJoin(join);
+		}
 	}
 	
 	inline void setFillColor(const ofFloatColor &c) {
 		nvgFillColor(ctx, toNVGcolor(c));
+		setColorPaint(fillPaint, toNVGcolor(c));
+		if (trace) {
+			trace->fillColor(toNVGcolor(c));
+		}
 	}
 	
 	inline void setFillPaint(const NVGpaint &paint) {
 		nvgFillPaint(ctx, paint);
+		fillPaint = paint;
+		float xform[6];
+		nvgCurrentTransform(ctx, xform);
+		nvgTransformMultiply(fillPaint.xform, xform);
+		if (trace) {
+			tracePaint(paint, false);
+		}
 	}
 	
 	inline void setStrokeColor(const ofFloatColor &c) {
 		nvgStrokeColor(ctx, toNVGcolor(c));
+		setColorPaint(strokePaint, toNVGcolor(c));
+		if (trace) {
+			trace->strokeColor(toNVGcolor(c));
+		}
 	}
 	
 	inline void setStrokePaint(const NVGpaint &paint) {
 		nvgStrokePaint(ctx, paint);
+		strokePaint = paint;
+		float xform[6];
+		nvgCurrentTransform(ctx, xform);
+		nvgTransformMultiply(strokePaint.xform, xform);
+		if (trace) {
+			tracePaint(paint, true);
+		}
 	}
 	
 	inline NVGpaint getLinearGradientPaint(float sx, float sy, float ex, float ey, const ofColor &c1, const ofColor &c2) {
 		return nvgLinearGradient(ctx, sx, sy, ex, ey, toNVGcolor(c1), toNVGcolor(c2));
 	}
 	
+	// tex centered on the origin. NanoVG's image for tex is made once and
+	// reused (also by drawSprites), it never deletes the texture.
 	NVGpaint getTexturePaint(const ofTexture& tex);
 	static inline NVGcolor toNVGcolor(const ofFloatColor& c) {
 		return nvgRGBAf(c.r, c.g, c.b, c.a);
@@ -213,10 +613,17 @@ public:
 	 */
 
 	struct Font {
-		int id;
+		int id;			// -1 until an async font is registered
 		string name;
+		string filename;
+		const unsigned char* data;	// font bytes when not loaded by nanovg from filename
+		int dataSize;
+		// keeps data mapped for addFont and addFontAsync, released with the font
+		std::shared_ptr<ofxNanoVGFontMap> mapping;
 		float letterSpacing;
 		float lineHeight;
+
+		bool isLoaded() const { return id >= 0; }
 	};
 
 	enum TextHorizontalAlign {
@@ -234,9 +641,23 @@ public:
 		NVG_ALIGN_BASELINE	= 1<<6, // Default, align text vertically to baseline.
 	};
 
-	// returns font id that can be used later
+	// returns font id that can be used later. The file is memory mapped and
+	// the mapping is shared with every other context that uses it. Adding
+	// the same name and file again returns the font added first.
 	Font* addFont(const string& name, const string& filename);
+	// use font data already in memory. It is not copied and must stay valid
+	// for the lifetime of the font.
+	Font* addFontMem(const string& name, const unsigned char* data, int size);
+	// map and validate the font file on a worker thread (shared like addFont's
+	// mappings). The font is returned right away but isn't loaded until
+	// processFonts() registers it on the GL thread (beginFrame calls it),
+	// after which onReady is called. Text drawn with a font that isn't loaded
+	// yet is skipped.
+	Font* addFontAsync(const string& name, const string& filename, std::function<void(Font*)> onReady=nullptr);
+	void processFonts();
 	Font* getFont(const string& name);
+	// mapped vs. resident bytes of the font files shared by all contexts
+	ofxNanoVGFontMap::Stats getFontMapStats() const { return ofxNanoVGFontMap::getStats(); }
 	float drawText(const string& fontName, float x, float y, const string& text, float fontSize);
 	float drawText(Font* font, float x, float y, const string& text, float fontSize);
 	void drawTextBox(const string& fontName, float x, float y, const string& text, float fontSize, float breakRowWidth, float lineHeight=-1);
@@ -248,6 +669,16 @@ public:
 	ofRectangle getTextBoxBounds(const string& fontName, float x, float y, const string& text, float fontSize, float breakRowWidth, float lineHeight=-1);
 	ofRectangle getTextBoxBounds(Font* font, float x, float y, const string& text, float fontSize, float breakRowWidth, float lineHeight=-1);
 	void setFontBlur(float blur);
+
+	// draw text from glyph pages of ofxNanoVG's own instead of NanoVG's font
+	// atlas, which is reset or grown as a whole when it fills up. Glyphs are
+	// uploaded as they are first drawn and the least recently used page is
+	// recycled once budget bytes of pages (textures and their CPU copies) are
+	// in use. Used by drawText and drawTextBox for fonts with data in memory
+	// (not loaded by nanovg from a filename) and not while tracing.
+	void setGlyphAtlas(bool enable, size_t budget=4*1024*1024, int pageSize=1024);
+	bool isGlyphAtlas() const { return bGlyphAtlas; }
+	const ofxNanoVGGlyphAtlas::Stats& getGlyphAtlasStats() { return glyphAtlas.getStats(); }
 	
 	/******
 	 * SVG
@@ -280,22 +711,378 @@ private:
 	int frameWidth, frameHeight;
 	float framePixRatio;
 
-	// for shapes
+	// for shapes, NanoVG's state mirrored for draws that bypass it or are
+	// tessellated on other threads
 	int vertexCount;
+	float strokeWidth;
+	int lineCap;
+	int lineJoin;
+	NVGpaint strokePaint;	// with the transform it was set under, like fillPaint
+	bool bScissor;
+	NVGscissor scissor;
+	void resetStyleState();
+
+	// hairline strokes
+	bool bHairlineFastPath;
+	int hairlineCount;
+	bool isHairline(float width);
+	void strokeHairline(const ofColor& c, float width, bool closed);
+
+	// colored polylines
+	static const int MAX_RAMP_SIZE = 4096;
+	vector<float> rampCoords;
+	vector<unsigned char> rampRow;		// premultiplied colors of the ramp being drawn
+	vector<unsigned char> rampData;		// and its texture
+	// ramp textures by content, kept while they are drawn every frame
+	struct RampImage {
+		int image;
+		int lastUsed;	// rampFrame
+		vector<unsigned char> row;
+	};
+	std::unordered_multimap<uint64_t, RampImage> rampImages;
+	map<int, vector<int> > freeRampImages;	// by width, not drawn in the last frame
+	int rampFrame;
+	int getRampImage(const vector<ofFloatColor>& ramp);
+	void releaseRampImages();
+	vector<int> frameImages;	// deleted after the frame is drawn
+
+	// sprites
+	struct SpriteImage {
+		int image;
+		int width, height;
+	};
+	map<GLuint, SpriteImage> spriteImages;	// by texture id, live as long as the context
+	vector<float> spritePoints;
+	vector<NVGvertex> spriteVerts;
+	ofVboMesh spriteMesh;		// sprites with different tints
+	int spriteBatchCount;
+	int getSpriteImage(const ofTexture& atlas);
+	void drawSpriteMesh(const ofTexture& atlas, const vector<ofFloatColor>& tints);
+	void strokeRamp(const vector<ofFloatColor>& ramp, float width, bool closed);
+
+	// geometry handed straight to the backend
+	vector<float> polylinePoints;	// local coordinates, x/y interleaved
+	struct DirectStroke {
+		bool ramp;
+		bool closed;
+		int order;				// in the queue, see flushQueue
+		float xform[6];
+		NVGscissor scissor;
+		NVGpaint paint;
+		float width;
+		int firstPoint, npts;	// in directPoints
+		int firstRamp;			// in directRampCoords
+		int firstVert, nverts;	// in directVerts
+	};
+	vector<DirectStroke> directStrokes;		// queued until flushQueue
+	vector<float> directPoints;
+	vector<float> directRampCoords;
+	vector<NVGvertex> directVerts;
+	vector<float> pickPoints;		// of a direct stroke being recorded for picking
+	void queueDirect(bool ramp, const NVGpaint& paint, float width, bool closed);
+	void drawDirect(const DirectStroke& stroke, const NVGvertex* verts);
+	void submitDirect(const NVGvertex* verts, int nverts, const NVGscissor& scissor, const std::function<void(NVGscissor*)>& submit);
+	void resetScissorState();
+
+	// fills and strokes tessellated on the thread pool: the path calls since
+	// beginPath are recorded and replayed into a headless NanoVG context per
+	// thread, whose backend keeps what it is handed for the real one
+	enum PathOp {
+		PATH_XFORM,			// a, b, c, d, e, f for the ops after it
+		PATH_MOVETO,		// x, y
+		PATH_LINETO,		// x, y
+		PATH_BEZIERTO,		// cx1, cy1, cx2, cy2, x, y
+		PATH_POLYLINE,		// count, then count x, y (a moveTo and lineTos)
+		PATH_RECT,			// x, y, w, h
+		PATH_ROUNDEDRECT,	// x, y, w, h, r_tl, r_tr, r_br, r_bl
+		PATH_ELLIPSE,		// cx, cy, rx, ry
+		PATH_ARC,			// cx, cy, r, a0, a1 (radians), dir
+		PATH_WINDING		// NVG_SOLID or NVG_HOLE
+	};
+	struct QueuedPath {
+		bool stroke;
+		int order;
+		int firstOp, endOp;		// in pathOps
+		size_t commands;		// pathCommands, for the memory stats
+		float xform[6];
+		NVGscissor scissor;
+		NVGpaint paint;			// the fill or stroke paint, then as NanoVG hands it to the backend
+		float strokeWidth;		// likewise
+		int lineCap, lineJoin;
+		// what the thread's context handed to its backend
+		int thread;
+		int firstPath, npaths;	// in the thread's paths
+		float fringe;
+		float bounds[4];
+	};
+	struct ThreadScratch {
+		NVGcontext* ctx;		// headless, created on first use
+		QueuedPath* capture;	// receives ctx's next render call
+		vector<NVGpath> paths;
+		vector<int> pathVerts;	// first fill and stroke vertex of every path
+		vector<NVGvertex> verts;
+		// direct strokes
+		vector<float> points;
+		vector<float> normals;
+		vector<float> dirs;
+		vector<float> sections;
+		vector<int> indices;
+	};
+	bool bQueuePaths;		// this frame (threads and no trace)
+	bool bPathOps;			// the current path's calls are in pathOps
+	bool bPathQueued;		// and are referenced by a queued path
+	vector<float> pathOps;	// of the queued paths and the current one
+	int pathStart;			// first op of the current path
+	float pathOpsXform[6];	// of the last PATH_XFORM
+	vector<QueuedPath> queuedPaths;
+	vector<NVGpath> submitPaths;
+	vector<ThreadScratch> threadScratch;	// one per thread of the pool
+	bool bFlushingQueue;
+	ofxNanoVGThreadPool threadPool;
+
+	inline bool canQueuePath() const {
+		return bPathOps && bQueuePaths && !bDamageActive && bakeState.bake == NULL;
+	}
+	inline void beginPathOps() {
+		if (!bPathQueued) {
+			pathOps.resize(pathStart);
+		}
+		pathStart = pathOps.size();
+		bPathOps = bQueuePaths && !bDamageActive;
+		bPathQueued = false;
+	}
+	// op and its arguments, after the current transform when it changed
+	inline void addPathOp(PathOp op, const float* args, int nargs) {
+		float xform[6];
+		nvgCurrentTransform(ctx, xform);
+		if ((int)pathOps.size() == pathStart || memcmp(xform, pathOpsXform, sizeof(xform)) != 0) {
+			memcpy(pathOpsXform, xform, sizeof(xform));
+			pathOps.push_back(PATH_XFORM);
+			pathOps.insert(pathOps.end(), xform, xform+6);
+		}
+		pathOps.push_back(op);
+		pathOps.insert(pathOps.end(), args, args+nargs);
+	}
+	void queuePath(bool stroke);
+	void flushQueue();
+	void clearQueue();
+	static void tessellateDirect(DirectStroke& stroke, ThreadScratch& scratch, const float* points, const float* rampCoords, float fringe, NVGvertex* verts);
+	void tessellatePath(QueuedPath& path, int thread);
+	void drawQueuedPath(const QueuedPath& path);
+	bool createWorkerContexts();
+	bool createWorkerContext(ThreadScratch& scratch);
+	void deleteWorkerContexts();
+	static void captureFill(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, const float* bounds, const NVGpath* paths, int npaths);
+	static void captureStroke(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths);
+	static void capturePaths(ThreadScratch& scratch, NVGpaint* paint, float fringe, const NVGpath* paths, int npaths);
+
+	// partial redraw
+	bool bPartialRedraw;
+	bool bDamageAll;
+	bool bDamageActive;
+	bool bDamageDebug;
+	bool bResumingFrame;
+	int maxDamageRegions;
+	vector<ofRectangle> pendingDamage;
+	vector<ofRectangle> damageRegions;
+
+	// picking
+	bool bPicking;
+	bool bRecordShapes;
+	int shapeId;
+	ofxNanoVGShapeIndex frameShapes;	// recorded during the current frame
+	ofxNanoVGShapeIndex pickIndex;		// built from the last finished frame
+	vector<ofVec2f> pathPoints;			// current path, flattened in frame coordinates
+	vector<ofxNanoVGShapeIndex::Contour> pathContours;
+
+	void recordMoveTo(float x, float y);
+	void recordLineTo(float x, float y);
+	void recordBezierTo(float cx1, float cy1, float cx2, float cy2, float x, float y);
+	void recordArc(float cx, float cy, float r, float a0, float a1, int dir);
+	void recordEllipse(float cx, float cy, float rx, float ry);
+	void recordRoundedRect(float x, float y, float w, float h, float r_tl, float r_tr, float r_br, float r_bl);
+	void recordShape(bool stroke);
+	void recordBoxShape(const float* bounds);
+	void recordStripShape(int id, const float* points, int npts, bool closed, float width);
+
+	// tracing
+	ofxNanoVGTrace traceWriter;
+	ofxNanoVGTrace* trace;		// set during traced frames
+	int traceFrames;
+
+	// the active trace, once the current transform is recorded in it
+	inline ofxNanoVGTrace* traceOp() {
+		float xform[6];
+		nvgCurrentTransform(ctx, xform);
+		trace->syncTransform(xform);
+		return trace;
+	}
+	void tracePaint(const NVGpaint& paint, bool stroke);
+	void traceTextState(Font* font, float fontSize, float lineHeight);
+
+	// bounds of the current path in frame coordinates, tracked while bTrackBounds
+	bool bTrackBounds;
+	float pathBounds[4];
+
+	inline void resetPathBounds() {
+		pathBounds[0] = pathBounds[1] = 1e30f;
+		pathBounds[2] = pathBounds[3] = -1e30f;
+	}
+	inline void trackPoint(float x, float y) {
+		if (!bTrackBounds) {
+			return;
+		}
+		float xform[6];
+		nvgCurrentTransform(ctx, xform);
+		growBounds(pathBounds, xform, x, y);
+	}
+	inline void trackBox(float x0, float y0, float x1, float y1) {
+		if (!bTrackBounds) {
+			return;
+		}
+		float xform[6];
+		nvgCurrentTransform(ctx, xform);
+		growBounds(pathBounds, xform, x0, y0);
+		growBounds(pathBounds, xform, x1, y0);
+		growBounds(pathBounds, xform, x1, y1);
+		growBounds(pathBounds, xform, x0, y1);
+	}
+	static inline void growBounds(float* bounds, const float* xform, float x, float y) {
+		float tx, ty;
+		nvgTransformPoint(&tx, &ty, xform, x, y);
+		bounds[0] = min(bounds[0], tx);
+		bounds[1] = min(bounds[1], ty);
+		bounds[2] = max(bounds[2], tx);
+		bounds[3] = max(bounds[3], ty);
+	}
+
+	void mergeDamage();
+	void drawDamaged(bool stroke);
+	void drawInDamage(const float* bounds, const std::function<void()>& draw);
+	void drawDamageOverlay();
 
 
 	NVGcontext* ctx;
+	int createFlags;
+	BufferSettings bufferSettings;
+
+	// memory accounting, fed by hooks around the backend's render calls
+	MemoryStats memStats;
+	size_t pathCommands;
+	int trimCount;
+	// floats each call appends to NanoVG's command buffer: the command and
+	// its points (see nvgMoveTo and friends in nanovg.c, testMemoryStats
+	// checks them against a context)
+	enum CommandSize {
+		CMD_MOVETO = 1 + 2,
+		CMD_LINETO = 1 + 2,
+		CMD_BEZIERTO = 1 + 3*2,
+		CMD_CLOSE = 1,
+		CMD_WINDING = 1 + 1,
+		CMD_RECT = CMD_MOVETO + 3*CMD_LINETO + CMD_CLOSE,
+		CMD_ELLIPSE = CMD_MOVETO + 4*CMD_BEZIERTO + CMD_CLOSE,
+		CMD_ROUNDEDRECT = CMD_MOVETO + 4*CMD_LINETO + 4*CMD_BEZIERTO + CMD_CLOSE
+	};
+	static int getArcCommands(float a0, float a1, int dir);
+	NVGparams backendParams;
+
+	void createContext();
+	void deleteContext();
+	void presizeBuffers();
+	void installRenderHooks();
+	void recordPathStats(const NVGpath* paths, int npaths, size_t nverts, size_t commands);
+	static inline void recordUsage(BufferStats& stats, size_t bytes) {
+		stats.current = bytes;
+		stats.highWater = max(stats.highWater, bytes);
+	}
+	static void renderFillHook(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, const float* bounds, const NVGpath* paths, int npaths);
+	static void renderStrokeHook(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths);
+	static void renderTrianglesHook(void* uptr, NVGpaint* paint, NVGscissor* scissor, const NVGvertex* verts, int nverts);
 
 	// fonts
 	vector<ofxNanoVG::Font*> fonts;
 
+	// text state NanoVG keeps, mirrored for the glyph atlas
+	NVGpaint fillPaint;
+	int textAlign;
+	float fontBlur;
+	void resetTextState();
+	static void setColorPaint(NVGpaint& paint, const NVGcolor& c);
+
+	// glyph atlas
+	bool bGlyphAtlas;
+	size_t glyphAtlasBudget;
+	int glyphAtlasPageSize;
+	ofxNanoVGGlyphAtlas glyphAtlas;
+	ofxNanoVGTextMeasure* boxMeasure;	// breaks text boxes drawn from the atlas
+	vector<NVGvertex> glyphVerts;
+	vector<int> glyphImages;
+	vector<int> glyphOrder;
+	vector<NVGvertex> glyphBatch;
+	bool drawAtlasText(Font* font, float fontSize, int align, float x, float y, const char* str, const char* end, float& endx);
+
+	struct PendingFont {
+		Font* font;
+		std::future<std::shared_ptr<ofxNanoVGFontMap> > data;
+		std::function<void(Font*)> onReady;
+	};
+	vector<PendingFont> pendingFonts;
+
+	Font* createFont(int id, const string& name);
+	static bool isFontData(const unsigned char* data, size_t size);
+
 	// perform stroke or fill according to the current OF style.
 	void doOFDraw();
 
+	// baking
+	struct BakeState {
+		ofxNanoVGBake* bake;
+		bool damageActive;		// suspended while baking
+		bool recordShapes;
+		ofxNanoVGTrace* trace;
+	};
+	BakeState bakeState;
+
 	ofxNanoVG() :
 		bInitialized(false),
 		bInFrame(false),
-		ctx(NULL) {}
+		strokeWidth(1),
+		lineCap(NVG_BUTT),
+		lineJoin(NVG_MITER),
+		bScissor(false),
+		bHairlineFastPath(true),
+		hairlineCount(0),
+		rampFrame(0),
+		spriteBatchCount(0),
+		bQueuePaths(false),
+		bPathOps(false),
+		bPathQueued(false),
+		pathStart(0),
+		bFlushingQueue(false),
+		bPartialRedraw(false),
+		bDamageAll(true),
+		bDamageActive(false),
+		bDamageDebug(false),
+		bResumingFrame(false),
+		maxDamageRegions(4),
+		bPicking(false),
+		bRecordShapes(false),
+		shapeId(-1),
+		trace(NULL),
+		traceFrames(0),
+		bTrackBounds(false),
+		ctx(NULL),
+		createFlags(0),
+		memStats(),
+		pathCommands(0),
+		trimCount(0),
+		textAlign(NVG_ALIGN_LEFT | NVG_ALIGN_BASELINE),
+		fontBlur(0),
+		bGlyphAtlas(false),
+		glyphAtlasBudget(0),
+		glyphAtlasPageSize(0),
+		boxMeasure(NULL),
+		bakeState() {}
 
 	// make sure there are no copies
 	ofxNanoVG(ofxNanoVG const&);
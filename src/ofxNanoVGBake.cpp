@@ -0,0 +1,288 @@
+//
+//  ofxNanoVGBake.cpp
+//  ofxNanoVG
+//
+
+#include "ofxNanoVGBake.h"
+
+// coverage NanoVG's shader computes from a vertex's texture coordinates
+static inline float getCoverage(float u, float v, float strokeMult)
+{
+	return min(1.0f, (1.0f - fabsf(u*2.0f - 1.0f)) * strokeMult) * min(1.0f, v);
+}
+
+ofxNanoVGBake::ofxNanoVGBake() :
+	skippedImages(0),
+	skippedGradients(0),
+	skippedScissored(0)
+{
+	mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+}
+
+void ofxNanoVGBake::clear()
+{
+	mesh.clear();
+	mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+	skippedImages = 0;
+	skippedGradients = 0;
+	skippedScissored = 0;
+}
+
+void ofxNanoVGBake::addFill(const NVGpaint &paint, const NVGscissor &scissor, float fringe, const NVGpath *paths, int npaths)
+{
+	if (!setPaint(paint, scissor)) {
+		return;
+	}
+
+	// like the backend, a single convex path is a fan and everything else
+	// is resolved by winding, where NanoVG would use the stencil buffer
+	bool convex = npaths == 1 && paths[0].convex;
+	if (convex) {
+		addFan(paths[0].fill, paths[0].nfill);
+	}
+	else {
+		contours.resize(npaths);
+		for (int i=0; i<npaths; i++) {
+			contours[i].clear();
+			for (int j=0; j<paths[i].nfill; j++) {
+				contours[i].addVertex(paths[i].fill[j].x, paths[i].fill[j].y);
+			}
+			contours[i].close();
+		}
+		tessMesh.clear();
+		tessellator.tessellateToMesh(contours, OF_POLY_WINDING_NONZERO, tessMesh, true);
+		const vector<ofVec3f>& verts = tessMesh.getVertices();
+		for (unsigned int index : tessMesh.getIndices()) {
+			addVertex(verts[index].x, verts[index].y, 1);
+		}
+	}
+
+	// the fringe is centered on the edge; NanoVG draws only its outer half
+	// around stenciled fills
+	for (int i=0; i<npaths; i++) {
+		addStrip(paths[i].stroke, paths[i].nstroke, 1, convex ? 0 : 0.5f);
+	}
+}
+
+void ofxNanoVGBake::addStroke(const NVGpaint &paint, const NVGscissor &scissor, float fringe, float strokeWidth, const NVGpath *paths, int npaths)
+{
+	if (!setPaint(paint, scissor)) {
+		return;
+	}
+
+	// same as glnvg__convertPaint
+	float strokeMult = (strokeWidth*0.5f + fringe*0.5f) / fringe;
+	for (int i=0; i<npaths; i++) {
+		addStrip(paths[i].stroke, paths[i].nstroke, strokeMult, 0);
+	}
+}
+
+void ofxNanoVGBake::addTriangles(const NVGpaint &paint, const NVGscissor &scissor, const NVGvertex *verts, int nverts)
+{
+	if (!setPaint(paint, scissor)) {
+		return;
+	}
+
+	for (int i=0; i<nverts; i++) {
+		addVertex(verts[i].x, verts[i].y, 1);
+	}
+}
+
+// the mesh only has a color per vertex, which can't follow a gradient or
+// image across a triangle, and no clipping (nvgResetScissor sets a negative
+// extent)
+bool ofxNanoVGBake::setPaint(const NVGpaint &paint, const NVGscissor &scissor)
+{
+	if (paint.image != 0) {
+		skippedImages++;
+		return false;
+	}
+	if (memcmp(&paint.innerColor, &paint.outerColor, sizeof(NVGcolor)) != 0) {
+		skippedGradients++;
+		return false;
+	}
+	if (scissor.extent[0] >= 0) {
+		skippedScissored++;
+		return false;
+	}
+
+	color = paint.innerColor;
+	return true;
+}
+
+void ofxNanoVGBake::addFan(const NVGvertex *verts, int nverts)
+{
+	for (int i=2; i<nverts; i++) {
+		addVertex(verts[0].x, verts[0].y, getCoverage(verts[0].u, verts[0].v, 1));
+		addVertex(verts[i-1].x, verts[i-1].y, getCoverage(verts[i-1].u, verts[i-1].v, 1));
+		addVertex(verts[i].x, verts[i].y, getCoverage(verts[i].u, verts[i].v, 1));
+	}
+}
+
+// A triangle strip of cross-sections (vertex pairs). The coverage is linear
+// in u only between its kinks, so every cross-section is split there and
+// the pieces of two neighbouring ones are joined by quads.
+void ofxNanoVGBake::addStrip(const NVGvertex *verts, int nverts, float strokeMult, float minU)
+{
+	Stop a[5], b[5];
+	for (int i=0; i+3<nverts; i+=2) {
+		int na = getStops(verts[i], verts[i+1], strokeMult, minU, a);
+		int nb = getStops(verts[i+2], verts[i+3], strokeMult, minU, b);
+		if (na == nb) {
+			for (int j=0; j+1<na; j++) {
+				addVertex(a[j].x, a[j].y, a[j].alpha);
+				addVertex(a[j+1].x, a[j+1].y, a[j+1].alpha);
+				addVertex(b[j].x, b[j].y, b[j].alpha);
+				addVertex(a[j+1].x, a[j+1].y, a[j+1].alpha);
+				addVertex(b[j+1].x, b[j+1].y, b[j+1].alpha);
+				addVertex(b[j].x, b[j].y, b[j].alpha);
+			}
+			continue;
+		}
+
+		// the cross-sections don't match (round caps and joins), keep the strip's own triangles
+		for (int k=0; k<2; k++) {
+			for (int j=0; j<3; j++) {
+				const NVGvertex& v = verts[i+k+j];
+				addVertex(v.x, v.y, getCoverage(v.u, v.v, strokeMult));
+			}
+		}
+	}
+}
+
+// points from a to b where the coverage changes slope, dropping what is
+// below minU; returns how many were written to stops (at most 5)
+int ofxNanoVGBake::getStops(const NVGvertex &a, const NVGvertex &b, float strokeMult, float minU, Stop *stops)
+{
+	// full coverage from k to 1-k, or a peak at 0.5 on lines thinner than the fringe
+	float k = min(0.5f / strokeMult, 0.5f);
+	const float kinks[3] = { minU, k, 1.0f - k };
+	float du = b.u - a.u;
+
+	float s[5];
+	int n = 0;
+	s[n++] = 0;
+	if (du != 0) {
+		for (float kink : kinks) {
+			float t = (kink - a.u) / du;
+			if (t > 0 && t < 1) {
+				s[n++] = t;
+			}
+		}
+	}
+	s[n++] = 1;
+	std::sort(s, s+n);
+
+	int count = 0;
+	for (int i=0; i<n; i++) {
+		float u = a.u + du*s[i];
+		if (u < minU - 1e-5f || (i > 0 && s[i] - s[i-1] < 1e-6f && count > 0)) {
+			continue;
+		}
+		Stop& stop = stops[count++];
+		stop.x = a.x + (b.x - a.x)*s[i];
+		stop.y = a.y + (b.y - a.y)*s[i];
+		stop.alpha = getCoverage(u, a.v + (b.v - a.v)*s[i], strokeMult);
+	}
+	return count;
+}
+
+// straight color for alpha blending, the coverage scales its alpha
+void ofxNanoVGBake::addVertex(float x, float y, float alpha)
+{
+	mesh.addVertex(ofVec3f(x, y, 0));
+	mesh.addColor(ofFloatColor(color.r, color.g, color.b, color.a * alpha));
+}
+
+void ofxNanoVGBake::draw() const
+{
+	if (empty()) {
+		return;
+	}
+
+	ofPushStyle();
+	ofEnableAlphaBlending();
+	mesh.draw();
+	ofPopStyle();
+}
+
+/******
+ * File
+ *
+ * MAGIC, VERSION, vertex count (uint32), then x, y of every vertex and
+ * r, g, b, a of every vertex as floats, little endian.
+ */
+
+bool ofxNanoVGBake::save(const string &filename) const
+{
+	FILE* file = fopen(ofToDataPath(filename).c_str(), "wb");
+	if (file == NULL) {
+		ofLogError("ofxNanoVGBake::save", "could not open file: %s", filename.c_str());
+		return false;
+	}
+
+	const vector<ofVec3f>& verts = mesh.getVertices();
+	const vector<ofFloatColor>& colors = mesh.getColors();
+	uint32_t header[3] = { MAGIC, VERSION, (uint32_t)verts.size() };
+	vector<float> data;
+	data.reserve(verts.size() * 6);
+	for (const ofVec3f& v : verts) {
+		data.push_back(v.x);
+		data.push_back(v.y);
+	}
+	for (const ofFloatColor& c : colors) {
+		data.push_back(c.r);
+		data.push_back(c.g);
+		data.push_back(c.b);
+		data.push_back(c.a);
+	}
+
+	bool ok = fwrite(header, sizeof(header), 1, file) == 1 &&
+		(data.empty() || fwrite(&data[0], sizeof(float), data.size(), file) == data.size());
+	fclose(file);
+	if (!ok) {
+		ofLogError("ofxNanoVGBake::save", "error writing file: %s", filename.c_str());
+	}
+	return ok;
+}
+
+bool ofxNanoVGBake::load(const string &filename)
+{
+	clear();
+
+	ofBuffer buffer = ofBufferFromFile(filename, true);
+	const char* bytes = buffer.getData();
+	uint32_t header[3] = { 0, 0, 0 };
+	if (buffer.size() >= sizeof(header)) {
+		memcpy(header, bytes, sizeof(header));
+	}
+	if (header[0] != MAGIC || header[1] != VERSION) {
+		ofLogError("ofxNanoVGBake::load", "not a bake file (or from another version): %s", filename.c_str());
+		return false;
+	}
+
+	size_t count = header[2];
+	if (buffer.size() != sizeof(header) + count*6*sizeof(float)) {
+		ofLogError("ofxNanoVGBake::load", "bake file is truncated or corrupt: %s", filename.c_str());
+		return false;
+	}
+
+	if (count == 0) {
+		return true;
+	}
+
+	vector<float> data(count*6);
+	memcpy(&data[0], bytes + sizeof(header), data.size() * sizeof(float));
+
+	vector<ofVec3f> verts(count);
+	vector<ofFloatColor> colors(count);
+	const float* xy = &data[0];
+	const float* rgba = xy + count*2;
+	for (size_t i=0; i<count; i++) {
+		verts[i] = ofVec3f(xy[i*2], xy[i*2+1], 0);
+		colors[i] = ofFloatColor(rgba[i*4], rgba[i*4+1], rgba[i*4+2], rgba[i*4+3]);
+	}
+	mesh.addVertices(verts);
+	mesh.addColors(colors);
+	return true;
+}
@@ -0,0 +1,78 @@
+//
+//  ofxNanoVGBake.h
+//  ofxNanoVG
+//
+//  Fills and strokes tessellated by NanoVG once and kept as a colored
+//  triangle mesh, so static artwork can be drawn again without NanoVG.
+//  The coverage NanoVG's shader computes across the AA fringe is baked into
+//  the vertex alpha: fringe strips are split where the coverage ramp ends,
+//  so the interpolation follows it along straight segments, miter and bevel
+//  joins and butt and square caps. Round caps and joins keep NanoVG's own
+//  triangles with the coverage at their vertices, which is close but not
+//  the same. Concave and multi path fills, which NanoVG draws with the
+//  stencil buffer, are triangulated with the same nonzero winding. Only
+//  solid colors are baked, draws with gradient or image paints or inside a
+//  scissor are skipped and counted. Coordinates are NanoVG's frame
+//  coordinates at the time of baking.
+//
+
+#ifndef __ofxNanoVG__ofxNanoVGBake__
+#define __ofxNanoVG__ofxNanoVGBake__
+
+#include "ofMain.h"
+#include "nanovg.h"
+
+class ofxNanoVGBake
+{
+public:
+	static const uint32_t MAGIC = 0x4247564e;	// "NVGB"
+	static const uint32_t VERSION = 1;
+
+	ofxNanoVGBake();
+
+	// what NanoVG hands to its backend (see NVGparams)
+	void addFill(const NVGpaint& paint, const NVGscissor& scissor, float fringe, const NVGpath* paths, int npaths);
+	void addStroke(const NVGpaint& paint, const NVGscissor& scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths);
+	void addTriangles(const NVGpaint& paint, const NVGscissor& scissor, const NVGvertex* verts, int nverts);
+
+	void clear();
+	bool empty() const { return mesh.getNumVertices() == 0; }
+	// draws that couldn't be baked, by reason
+	int getSkippedImages() const { return skippedImages; }			// textures and text
+	int getSkippedGradients() const { return skippedGradients; }
+	int getSkippedScissored() const { return skippedScissored; }
+	int getSkippedDraws() const { return skippedImages + skippedGradients + skippedScissored; }
+
+	// triangles with non-premultiplied colors, drawn with alpha blending
+	ofVboMesh& getMesh() { return mesh; }
+	const ofVboMesh& getMesh() const { return mesh; }
+	// draw with the current OF transform and style, outside a NanoVG frame
+	// (use ofxNanoVG::drawBake inside one)
+	void draw() const;
+
+	bool save(const string& filename) const;
+	bool load(const string& filename);
+
+private:
+	struct Stop {
+		float x, y;
+		float alpha;
+	};
+
+	bool setPaint(const NVGpaint& paint, const NVGscissor& scissor);
+	void addStrip(const NVGvertex* verts, int nverts, float strokeMult, float minU);
+	void addFan(const NVGvertex* verts, int nverts);
+	void addVertex(float x, float y, float alpha);
+	static int getStops(const NVGvertex& a, const NVGvertex& b, float strokeMult, float minU, Stop* stops);
+
+	ofVboMesh mesh;
+	NVGcolor color;			// of the draw being added
+	ofTessellator tessellator;
+	ofMesh tessMesh;
+	vector<ofPolyline> contours;
+	int skippedImages;
+	int skippedGradients;
+	int skippedScissored;
+};
+
+#endif /* defined(__ofxNanoVG__ofxNanoVGBake__) */
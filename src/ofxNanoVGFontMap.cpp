@@ -0,0 +1,167 @@
+//
+//  ofxNanoVGFontMap.cpp
+//  ofxNanoVG
+//
+
+#include "ofxNanoVGFontMap.h"
+
+#ifdef TARGET_WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::mutex ofxNanoVGFontMap::registryMutex;
+std::map<string, std::weak_ptr<ofxNanoVGFontMap> > ofxNanoVGFontMap::registry;
+
+ofxNanoVGFontMap::~ofxNanoVGFontMap()
+{
+	if (data == NULL) {
+		return;
+	}
+
+#ifdef TARGET_WIN32
+	UnmapViewOfFile(data);
+	CloseHandle((HANDLE)handle);
+#else
+	munmap((void*)data, dataSize);
+#endif
+}
+
+std::shared_ptr<ofxNanoVGFontMap> ofxNanoVGFontMap::open(const string &filename)
+{
+	string path = ofToDataPath(filename, true);
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	auto it = registry.find(path);
+	if (it != registry.end()) {
+		std::shared_ptr<ofxNanoVGFontMap> existing = it->second.lock();
+		if (existing) {
+			return existing;
+		}
+	}
+
+	std::shared_ptr<ofxNanoVGFontMap> mapping(new ofxNanoVGFontMap());
+	if (!mapping->map(path)) {
+		ofLogError("ofxNanoVGFontMap", "could not map font file: %s", path.c_str());
+		return std::shared_ptr<ofxNanoVGFontMap>();
+	}
+
+	// drop entries whose mappings were released
+	for (auto r = registry.begin(); r != registry.end();) {
+		if (r->second.expired()) {
+			r = registry.erase(r);
+		}
+		else {
+			++r;
+		}
+	}
+	registry[path] = mapping;
+
+	return mapping;
+}
+
+bool ofxNanoVGFontMap::map(const string &filename)
+{
+	path = filename;
+
+#ifdef TARGET_WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL) {
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL) {
+		CloseHandle(mapping);
+		return false;
+	}
+
+	handle = mapping;
+	data = (const unsigned char*)view;
+	dataSize = (size_t)fileSize.QuadPart;
+#else
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return false;
+	}
+
+	// only read, so nothing needs to be shared with the file
+	void* view = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED) {
+		return false;
+	}
+
+	data = (const unsigned char*)view;
+	dataSize = st.st_size;
+#endif
+
+	return true;
+}
+
+size_t ofxNanoVGFontMap::getResidentBytes() const
+{
+#ifdef TARGET_WIN32
+	return 0;
+#else
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	size_t pages = (dataSize + pageSize - 1) / pageSize;
+#ifdef TARGET_OSX
+	vector<char> resident(pages);
+#else
+	vector<unsigned char> resident(pages);
+#endif
+	if (mincore((void*)data, dataSize, resident.data()) != 0) {
+		return 0;
+	}
+
+	size_t bytes = 0;
+	for (size_t i=0; i<pages; i++) {
+		if (resident[i] & 1) {
+			bytes += min(pageSize, dataSize - i*pageSize);
+		}
+	}
+	return bytes;
+#endif
+}
+
+ofxNanoVGFontMap::Stats ofxNanoVGFontMap::getStats()
+{
+	Stats stats = { 0, 0, 0 };
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (auto& entry : registry) {
+		std::shared_ptr<ofxNanoVGFontMap> mapping = entry.second.lock();
+		if (!mapping) {
+			continue;
+		}
+		stats.files++;
+		stats.mappedBytes += mapping->size();
+		stats.residentBytes += mapping->getResidentBytes();
+	}
+
+	return stats;
+}
@@ -0,0 +1,51 @@
+//
+//  ofxNanoVGFontMap.h
+//  ofxNanoVG
+//
+//  Read-only memory mapping of a font file, shared by every NanoVG context
+//  in the process. Mappings are reference counted and unmapped when the
+//  last user releases them; each context only keeps its own glyph atlas.
+//
+
+#ifndef __ofxNanoVG__ofxNanoVGFontMap__
+#define __ofxNanoVG__ofxNanoVGFontMap__
+
+#include "ofMain.h"
+
+class ofxNanoVGFontMap
+{
+public:
+	~ofxNanoVGFontMap();
+
+	// returns the existing mapping of the file or maps it, NULL on failure
+	static std::shared_ptr<ofxNanoVGFontMap> open(const string& filename);
+
+	struct Stats {
+		int files;
+		size_t mappedBytes;		// size of all mapped font files
+		size_t residentBytes;	// part of it currently in physical memory (0 where unsupported)
+	};
+	static Stats getStats();
+
+	const unsigned char* getData() const { return data; }
+	size_t size() const { return dataSize; }
+	const string& getPath() const { return path; }
+	size_t getResidentBytes() const;
+
+private:
+	ofxNanoVGFontMap() : data(NULL), dataSize(0), handle(NULL) {}
+	ofxNanoVGFontMap(ofxNanoVGFontMap const&);
+	void operator=(ofxNanoVGFontMap const&);
+
+	bool map(const string& filename);
+
+	const unsigned char* data;
+	size_t dataSize;
+	string path;
+	void* handle;	// file mapping handle on windows
+
+	static std::mutex registryMutex;
+	static std::map<string, std::weak_ptr<ofxNanoVGFontMap> > registry;
+};
+
+#endif /* defined(__ofxNanoVG__ofxNanoVGFontMap__) */
@@ -0,0 +1,369 @@
+//
+//  ofxNanoVGGlyphAtlas.cpp
+//  ofxNanoVG
+//
+
+#include "ofxNanoVGGlyphAtlas.h"
+
+// declarations only, the implementation is compiled into nanovg.c
+extern "C" {
+#include "fontstash.h"
+}
+
+// the private stash only holds bitmaps until they are copied into a page
+#define GLYPH_STASH_SIZE 1024
+#define GLYPH_PADDING 1
+
+ofxNanoVGGlyphAtlas::ofxNanoVGGlyphAtlas() :
+	ctx(NULL),
+	fs(NULL),
+	pageSize(1024),
+	frame(0),
+	stats()
+{
+}
+
+ofxNanoVGGlyphAtlas::~ofxNanoVGGlyphAtlas()
+{
+	// the context may be gone already, only free what is ours
+	for (Page* page : pages) {
+		delete page;
+	}
+	if (fs != NULL) {
+		fonsDeleteInternal(fs);
+	}
+}
+
+void ofxNanoVGGlyphAtlas::setup(NVGcontext *ctx, size_t budget, int pageSize)
+{
+	clear();
+	this->ctx = ctx;
+	this->pageSize = pageSize;
+	stats = Stats();
+	stats.budget = budget;
+
+	if (fs == NULL) {
+		FONSparams params;
+		memset(&params, 0, sizeof(params));
+		params.width = GLYPH_STASH_SIZE;
+		params.height = GLYPH_STASH_SIZE;
+		params.flags = FONS_ZERO_TOPLEFT;
+		fs = fonsCreateInternal(&params);
+		fonsSetErrorCallback(fs, handleFonsError, fs);
+	}
+}
+
+void ofxNanoVGGlyphAtlas::clear()
+{
+	while (!pages.empty()) {
+		deletePage(pages.back());
+	}
+	glyphs.clear();
+	ctx = NULL;
+}
+
+void ofxNanoVGGlyphAtlas::handleFonsError(void* uptr, int error, int val)
+{
+	if (error == FONS_ATLAS_FULL) {
+		fonsResetAtlas((FONScontext*)uptr, GLYPH_STASH_SIZE, GLYPH_STASH_SIZE);
+	}
+}
+
+void ofxNanoVGGlyphAtlas::beginFrame()
+{
+	frame++;
+}
+
+void ofxNanoVGGlyphAtlas::resetFrameStats()
+{
+	stats.uploadBytes = 0;
+	stats.rasterized = 0;
+}
+
+void ofxNanoVGGlyphAtlas::endFrame()
+{
+	while (pages.size() * getPageBytes() > stats.budget && pages.size() > 1) {
+		deletePage(getLeastRecentlyUsed(true));
+		stats.evictions++;
+	}
+}
+
+int ofxNanoVGGlyphAtlas::getFontId(const unsigned char *data, int size)
+{
+	auto it = fontIds.find(data);
+	if (it != fontIds.end()) {
+		return it->second;
+	}
+
+	int fontId = fonsAddFontMem(fs, ofToString((size_t)data).c_str(), const_cast<unsigned char*>(data), size, 0);
+	fontIds[data] = fontId;
+	return fontId;
+}
+
+float ofxNanoVGGlyphAtlas::layout(const TextStyle &style, float x, float y, const char *str, const char *end, vector<NVGvertex> &verts, vector<int> &images)
+{
+	if (ctx == NULL) {
+		return x;
+	}
+
+	int fontId = getFontId(style.fontData, style.fontDataSize);
+	if (fontId < 0) {
+		return x;
+	}
+
+	// same state nanovg sets up for drawing
+	fonsClearState(fs);
+	fonsSetSize(fs, style.size);
+	fonsSetSpacing(fs, style.spacing);
+	fonsSetBlur(fs, style.blur);
+	fonsSetAlign(fs, style.align);
+	fonsSetFont(fs, fontId);
+
+	FONStextIter iter;
+	FONSquad q;
+	fonsTextIterInit(fs, &iter, x, y, str, end, FONS_GLYPH_BITMAP_REQUIRED);
+	while (fonsTextIterNext(fs, &iter, &q)) {
+		// the glyph could not be rasterized
+		if (iter.prevGlyphIndex == -1) {
+			continue;
+		}
+
+		uint64_t key = ((uint64_t)(fontId & 0xffff) << 48) | ((uint64_t)(iter.isize & 0xffff) << 32) |
+			((uint64_t)(iter.iblur & 0xff) << 24) | (iter.codepoint & 0xffffff);
+		Glyph* glyph = getGlyph(key, q.s0, q.t0, q.s1, q.t1);
+		if (glyph == NULL) {
+			continue;
+		}
+
+		float s0 = (float)glyph->x / pageSize;
+		float t0 = (float)glyph->y / pageSize;
+		float s1 = (float)(glyph->x + glyph->w) / pageSize;
+		float t1 = (float)(glyph->y + glyph->h) / pageSize;
+		NVGvertex v[4] = {
+			{ q.x0, q.y0, s0, t0 },
+			{ q.x1, q.y0, s1, t0 },
+			{ q.x1, q.y1, s1, t1 },
+			{ q.x0, q.y1, s0, t1 }
+		};
+		verts.push_back(v[0]);
+		verts.push_back(v[2]);
+		verts.push_back(v[1]);
+		verts.push_back(v[0]);
+		verts.push_back(v[3]);
+		verts.push_back(v[2]);
+		images.push_back(glyph->page->image);
+	}
+
+	uploadDirty();
+	return iter.nextx;
+}
+
+ofxNanoVGGlyphAtlas::Glyph* ofxNanoVGGlyphAtlas::getGlyph(uint64_t key, float s0, float t0, float s1, float t1)
+{
+	auto it = glyphs.find(key);
+	if (it != glyphs.end()) {
+		it->second.page->lastUsed = frame;
+		return &it->second;
+	}
+
+	// the bitmap stays in the stash's atlas until the next glyph is rasterized
+	int sw, sh;
+	const unsigned char* data = fonsGetTextureData(fs, &sw, &sh);
+	int gx = (int)(s0*sw + 0.5f);
+	int gy = (int)(t0*sh + 0.5f);
+	int gw = (int)(s1*sw + 0.5f) - gx;
+	int gh = (int)(t1*sh + 0.5f) - gy;
+
+	int px, py;
+	Page* page = allocRect(gw + GLYPH_PADDING*2, gh + GLYPH_PADDING*2, px, py);
+	if (page == NULL) {
+		ofLogError("ofxNanoVGGlyphAtlas", "glyph of %dx%d doesn't fit in a page of %d", gw, gh, pageSize);
+		return NULL;
+	}
+
+	// copy with a transparent border, so filtering never reads a neighbour
+	int w = gw + GLYPH_PADDING*2;
+	int h = gh + GLYPH_PADDING*2;
+	for (int row=0; row<h; row++) {
+		unsigned char* dst = &page->pixels[(py+row)*pageSize + px];
+		int srow = row - GLYPH_PADDING;
+		if (srow < 0 || srow >= gh) {
+			memset(dst, 0, w);
+			continue;
+		}
+		memset(dst, 0, GLYPH_PADDING);
+		memcpy(dst + GLYPH_PADDING, data + (gy+srow)*sw + gx, gw);
+		memset(dst + GLYPH_PADDING + gw, 0, GLYPH_PADDING);
+	}
+
+	page->dirty[0] = min(page->dirty[0], px);
+	page->dirty[1] = min(page->dirty[1], py);
+	page->dirty[2] = max(page->dirty[2], px + w);
+	page->dirty[3] = max(page->dirty[3], py + h);
+	page->usedArea += w*h;
+	page->lastUsed = frame;
+	page->glyphs.push_back(key);
+	stats.rasterized++;
+
+	Glyph& glyph = glyphs[key];
+	glyph.page = page;
+	glyph.x = px + GLYPH_PADDING;
+	glyph.y = py + GLYPH_PADDING;
+	glyph.w = gw;
+	glyph.h = gh;
+	return &glyph;
+}
+
+ofxNanoVGGlyphAtlas::Page* ofxNanoVGGlyphAtlas::allocRect(int w, int h, int &x, int &y)
+{
+	if (w > pageSize || h > pageSize) {
+		return NULL;
+	}
+
+	for (Page* page : pages) {
+		if (packShelf(page, w, h, x, y)) {
+			return page;
+		}
+	}
+
+	Page* page = NULL;
+	if ((pages.size()+1) * getPageBytes() <= stats.budget || pages.empty()) {
+		page = addPage();
+	}
+	else {
+		page = getLeastRecentlyUsed(false);
+		if (page != NULL) {
+			recyclePage(page);
+			stats.evictions++;
+		}
+		else {
+			page = addPage();
+			stats.overBudget++;
+		}
+	}
+
+	if (page == NULL || !packShelf(page, w, h, x, y)) {
+		return NULL;
+	}
+	return page;
+}
+
+// put the rect on the lowest shelf it fits, or open a new one below the others
+bool ofxNanoVGGlyphAtlas::packShelf(Page *page, int w, int h, int &x, int &y)
+{
+	Shelf* best = NULL;
+	for (Shelf& shelf : page->shelves) {
+		if (h <= shelf.height && shelf.x + w <= pageSize && (best == NULL || shelf.height < best->height)) {
+			best = &shelf;
+		}
+	}
+
+	if (best == NULL) {
+		int top = page->shelves.empty() ? 0 : page->shelves.back().y + page->shelves.back().height;
+		if (top + h > pageSize) {
+			return false;
+		}
+		Shelf shelf;
+		shelf.y = top;
+		shelf.height = h;
+		shelf.x = 0;
+		page->shelves.push_back(shelf);
+		best = &page->shelves.back();
+	}
+
+	x = best->x;
+	y = best->y;
+	best->x += w;
+	return true;
+}
+
+ofxNanoVGGlyphAtlas::Page* ofxNanoVGGlyphAtlas::addPage()
+{
+	NVGparams* params = nvgInternalParams(ctx);
+	int image = params->renderCreateTexture(params->userPtr, NVG_TEXTURE_ALPHA, pageSize, pageSize, 0, NULL);
+	if (image <= 0) {
+		ofLogError("ofxNanoVGGlyphAtlas") << "error creating glyph page";
+		return NULL;
+	}
+
+	Page* page = new Page();
+	page->image = image;
+	page->lastUsed = frame;
+	page->usedArea = 0;
+	page->pixels.resize((size_t)pageSize * pageSize, 0);
+	page->dirty[0] = page->dirty[1] = pageSize;
+	page->dirty[2] = page->dirty[3] = 0;
+	pages.push_back(page);
+	return page;
+}
+
+// start over on the page, the texture is kept and overwritten glyph by glyph
+void ofxNanoVGGlyphAtlas::recyclePage(Page *page)
+{
+	for (uint64_t key : page->glyphs) {
+		glyphs.erase(key);
+	}
+	page->glyphs.clear();
+	page->shelves.clear();
+	page->usedArea = 0;
+	page->lastUsed = frame;
+}
+
+void ofxNanoVGGlyphAtlas::deletePage(Page *page)
+{
+	for (uint64_t key : page->glyphs) {
+		glyphs.erase(key);
+	}
+	if (ctx != NULL) {
+		NVGparams* params = nvgInternalParams(ctx);
+		params->renderDeleteTexture(params->userPtr, page->image);
+	}
+	pages.erase(std::find(pages.begin(), pages.end(), page));
+	delete page;
+}
+
+ofxNanoVGGlyphAtlas::Page* ofxNanoVGGlyphAtlas::getLeastRecentlyUsed(bool includeCurrent)
+{
+	Page* lru = NULL;
+	for (Page* page : pages) {
+		if (!includeCurrent && page->lastUsed == frame) {
+			continue;
+		}
+		if (lru == NULL || page->lastUsed < lru->lastUsed) {
+			lru = page;
+		}
+	}
+	return lru;
+}
+
+// the backend reads the rect out of the whole page, like fontstash's atlas
+void ofxNanoVGGlyphAtlas::uploadDirty()
+{
+	NVGparams* params = nvgInternalParams(ctx);
+	for (Page* page : pages) {
+		int* d = page->dirty;
+		if (d[0] >= d[2] || d[1] >= d[3]) {
+			continue;
+		}
+
+		params->renderUpdateTexture(params->userPtr, page->image, d[0], d[1], d[2]-d[0], d[3]-d[1], &page->pixels[0]);
+		size_t bytes = (size_t)(d[2]-d[0]) * (d[3]-d[1]);
+		stats.uploadBytes += bytes;
+		stats.totalUploadBytes += bytes;
+		d[0] = d[1] = pageSize;
+		d[2] = d[3] = 0;
+	}
+}
+
+const ofxNanoVGGlyphAtlas::Stats& ofxNanoVGGlyphAtlas::getStats()
+{
+	size_t used = 0;
+	for (Page* page : pages) {
+		used += page->usedArea;
+	}
+	stats.pages = pages.size();
+	stats.glyphs = glyphs.size();
+	stats.bytes = pages.size() * getPageBytes();
+	stats.occupancy = pages.empty() ? 0 : (float)used / (pages.size() * pageSize * pageSize);
+	return stats;
+}
@@ -0,0 +1,122 @@
+//
+//  ofxNanoVGGlyphAtlas.h
+//  ofxNanoVG
+//
+//  Glyph cache in texture pages owned by ofxNanoVG instead of NanoVG's
+//  single font atlas. Glyphs are rasterized by a private fontstash instance
+//  and copied into fixed size alpha pages, packed in shelves; only the
+//  rectangles that changed are uploaded. Every page also keeps a CPU copy of
+//  its pixels, which counts against the budget. When the budget is reached
+//  the least recently drawn page is recycled as a whole. Pages drawn from
+//  in the current frame are never touched since their draws are still
+//  queued in the backend, if all of them are a page is added over the
+//  budget and given back at endFrame.
+//
+
+#ifndef __ofxNanoVG__ofxNanoVGGlyphAtlas__
+#define __ofxNanoVG__ofxNanoVGGlyphAtlas__
+
+#include "ofMain.h"
+#include "nanovg.h"
+#include <unordered_map>
+
+struct FONScontext;
+
+class ofxNanoVGGlyphAtlas
+{
+public:
+	ofxNanoVGGlyphAtlas();
+	~ofxNanoVGGlyphAtlas();
+
+	struct Stats {
+		int pages;
+		int glyphs;
+		float occupancy;			// packed glyph area / page area
+		size_t bytes;				// texture memory and CPU copies of the pages
+		size_t budget;
+		int evictions;				// pages recycled or given back, since setup
+		int overBudget;				// pages added past the budget because every page was in use
+		size_t uploadBytes;			// texels uploaded in the current frame
+		size_t totalUploadBytes;	// since setup
+		int rasterized;				// glyphs added in the current frame
+	};
+
+	// pages are pageSize x pageSize alpha textures created through ctx's backend
+	void setup(NVGcontext* ctx, size_t budget, int pageSize);
+	// delete the pages, before the context goes away
+	void clear();
+	bool isSetup() const { return ctx != NULL; }
+
+	// pages used after beginFrame can't be recycled until the next one
+	void beginFrame();
+	void resetFrameStats();
+	// give back pages over the budget, once the frame is drawn
+	void endFrame();
+
+	struct TextStyle {
+		const unsigned char* fontData;
+		int fontDataSize;
+		float size;			// in font pixels, like spacing and blur
+		float spacing;
+		float blur;
+		int align;
+	};
+
+	// lay out text like nvgText with x, y and the glyph quads in font pixels
+	// (local coordinates times the font scale). Appends 6 vertices per glyph
+	// to verts and the page image it samples to images, returns the end x.
+	float layout(const TextStyle& style, float x, float y, const char* str, const char* end, vector<NVGvertex>& verts, vector<int>& images);
+
+	const Stats& getStats();
+
+private:
+	struct Shelf {
+		int y, height;
+		int x;
+	};
+
+	struct Page {
+		int image;
+		int lastUsed;				// frame
+		int usedArea;
+		vector<unsigned char> pixels;
+		vector<Shelf> shelves;
+		vector<uint64_t> glyphs;	// keys, to drop them when the page is recycled
+		int dirty[4];				// x0, y0, x1, y1
+	};
+
+	struct Glyph {
+		Page* page;
+		int x, y, w, h;				// bitmap without the padding
+	};
+
+	int getFontId(const unsigned char* data, int size);
+	// st is the glyph's rect in the private stash's atlas, as in FONSquad
+	Glyph* getGlyph(uint64_t key, float s0, float t0, float s1, float t1);
+	Page* allocRect(int w, int h, int& x, int& y);
+	bool packShelf(Page* page, int w, int h, int& x, int& y);
+	Page* addPage();
+	void recyclePage(Page* page);
+	void deletePage(Page* page);
+	Page* getLeastRecentlyUsed(bool includeCurrent);
+	void uploadDirty();
+	// the alpha texture and its copy in pixels
+	size_t getPageBytes() const { return (size_t)pageSize * pageSize * 2; }
+
+	static void handleFonsError(void* uptr, int error, int val);
+
+	NVGcontext* ctx;
+	FONScontext* fs;
+	std::map<const unsigned char*, int> fontIds;
+	vector<Page*> pages;
+	std::unordered_map<uint64_t, Glyph> glyphs;
+	int pageSize;
+	int frame;
+	Stats stats;
+
+	// make sure there are no copies
+	ofxNanoVGGlyphAtlas(ofxNanoVGGlyphAtlas const&);
+	void operator=(ofxNanoVGGlyphAtlas const&);
+};
+
+#endif /* defined(__ofxNanoVG__ofxNanoVGGlyphAtlas__) */
@@ -0,0 +1,249 @@
+//
+//  ofxNanoVGShapeIndex.cpp
+//  ofxNanoVG
+//
+
+#include "ofxNanoVGShapeIndex.h"
+
+#define SHAPES_PER_LEAF 4
+// the tree is split at medians, so its depth is about log2 of the shape count
+#define MAX_PICK_DEPTH 64
+
+void ofxNanoVGShapeIndex::clear()
+{
+	shapes.clear();
+	contours.clear();
+	points.clear();
+	nodes.clear();
+	order.clear();
+	bBuilt = false;
+}
+
+void ofxNanoVGShapeIndex::addShape(int id, ShapeType type, float strokeWidth, const ofVec2f* pts, const Contour* ctrs, int ncontours)
+{
+	Shape shape;
+	shape.id = id;
+	shape.type = type;
+	shape.halfWidth = type == SHAPE_STROKE ? strokeWidth*0.5f + strokeTolerance : 0;
+	shape.bounds[0] = shape.bounds[1] = 1e30f;
+	shape.bounds[2] = shape.bounds[3] = -1e30f;
+	shape.firstContour = contours.size();
+	shape.ncontours = 0;
+
+	for (int c=0; c<ncontours; c++) {
+		if (ctrs[c].count == 0) {
+			continue;
+		}
+
+		Contour contour = ctrs[c];
+		contour.first = points.size();
+		points.insert(points.end(), pts + ctrs[c].first, pts + ctrs[c].first + ctrs[c].count);
+		if (type == SHAPE_FILL) {
+			orientContour(contour);
+		}
+		contours.push_back(contour);
+		shape.ncontours++;
+
+		for (int i=0; i<contour.count; i++) {
+			const ofVec2f& p = pts[ctrs[c].first + i];
+			shape.bounds[0] = min(shape.bounds[0], p.x);
+			shape.bounds[1] = min(shape.bounds[1], p.y);
+			shape.bounds[2] = max(shape.bounds[2], p.x);
+			shape.bounds[3] = max(shape.bounds[3], p.y);
+		}
+	}
+
+	if (shape.ncontours == 0) {
+		return;
+	}
+
+	shape.bounds[0] -= shape.halfWidth;
+	shape.bounds[1] -= shape.halfWidth;
+	shape.bounds[2] += shape.halfWidth;
+	shape.bounds[3] += shape.halfWidth;
+	shapes.push_back(shape);
+	bBuilt = false;
+}
+
+// same area sign and rule as nvg__polyArea and nvg__flattenPaths: solid
+// contours get a positive area, holes a negative one
+void ofxNanoVGShapeIndex::orientContour(const Contour& contour)
+{
+	if (contour.count <= 2) {
+		return;
+	}
+
+	ofVec2f* p = &points[contour.first];
+	float area = 0;
+	for (int i=2; i<contour.count; i++) {
+		float abx = p[i-1].x - p[0].x;
+		float aby = p[i-1].y - p[0].y;
+		float acx = p[i].x - p[0].x;
+		float acy = p[i].y - p[0].y;
+		area += acx*aby - abx*acy;
+	}
+	if (contour.hole ? area > 0 : area < 0) {
+		std::reverse(p, p + contour.count);
+	}
+}
+
+void ofxNanoVGShapeIndex::build()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	nodes.clear();
+	nodes.reserve(shapes.size()*2 / SHAPES_PER_LEAF + 1);
+	order.resize(shapes.size());
+	for (size_t i=0; i<shapes.size(); i++) {
+		order[i] = i;
+	}
+	if (!shapes.empty()) {
+		buildNode(0, shapes.size());
+	}
+	bBuilt = true;
+
+	auto end = std::chrono::high_resolution_clock::now();
+	buildTime = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+// split the shapes at the median of the longest axis of their centers
+int ofxNanoVGShapeIndex::buildNode(int first, int count)
+{
+	int index = nodes.size();
+	nodes.push_back(Node());
+
+	Node node;
+	node.bounds[0] = node.bounds[1] = 1e30f;
+	node.bounds[2] = node.bounds[3] = -1e30f;
+	node.maxShape = -1;
+	float cmin[2] = { 1e30f, 1e30f };
+	float cmax[2] = { -1e30f, -1e30f };
+	for (int i=first; i<first+count; i++) {
+		const Shape& s = shapes[order[i]];
+		node.bounds[0] = min(node.bounds[0], s.bounds[0]);
+		node.bounds[1] = min(node.bounds[1], s.bounds[1]);
+		node.bounds[2] = max(node.bounds[2], s.bounds[2]);
+		node.bounds[3] = max(node.bounds[3], s.bounds[3]);
+		node.maxShape = max(node.maxShape, order[i]);
+		for (int a=0; a<2; a++) {
+			float c = (s.bounds[a] + s.bounds[a+2]) * 0.5f;
+			cmin[a] = min(cmin[a], c);
+			cmax[a] = max(cmax[a], c);
+		}
+	}
+	node.first = first;
+	node.count = count;
+	node.left = node.right = -1;
+
+	if (count > SHAPES_PER_LEAF) {
+		int axis = (cmax[0]-cmin[0] >= cmax[1]-cmin[1]) ? 0 : 1;
+		int half = count/2;
+		const vector<Shape>& s = shapes;
+		std::nth_element(order.begin()+first, order.begin()+first+half, order.begin()+first+count, [&s, axis](int a, int b) {
+			return s[a].bounds[axis] + s[a].bounds[axis+2] < s[b].bounds[axis] + s[b].bounds[axis+2];
+		});
+		node.left = buildNode(first, half);
+		node.right = buildNode(first+half, count-half);
+	}
+
+	nodes[index] = node;
+	return index;
+}
+
+int ofxNanoVGShapeIndex::pick(float x, float y) const
+{
+	if (!bBuilt || nodes.empty()) {
+		return -1;
+	}
+
+	int best = -1;
+	int stack[MAX_PICK_DEPTH + 1];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& node = nodes[stack[--top]];
+		if (node.maxShape <= best ||
+			x < node.bounds[0] || x > node.bounds[2] || y < node.bounds[1] || y > node.bounds[3]) {
+			continue;
+		}
+
+		if (node.left < 0) {
+			for (int i=node.first; i<node.first+node.count; i++) {
+				int s = order[i];
+				if (s > best && hitShape(shapes[s], x, y)) {
+					best = s;
+				}
+			}
+		}
+		else {
+			// visit the child holding later shapes first, it prunes more
+			if (nodes[node.left].maxShape > nodes[node.right].maxShape) {
+				stack[top++] = node.right;
+				stack[top++] = node.left;
+			}
+			else {
+				stack[top++] = node.left;
+				stack[top++] = node.right;
+			}
+		}
+	}
+
+	return best >= 0 ? shapes[best].id : -1;
+}
+
+static float segmentDistanceSquared(const ofVec2f& a, const ofVec2f& b, float x, float y)
+{
+	float dx = b.x - a.x;
+	float dy = b.y - a.y;
+	float len2 = dx*dx + dy*dy;
+	float t = len2 > 0 ? ofClamp(((x - a.x)*dx + (y - a.y)*dy) / len2, 0, 1) : 0;
+	float px = a.x + dx*t - x;
+	float py = a.y + dy*t - y;
+	return px*px + py*py;
+}
+
+bool ofxNanoVGShapeIndex::hitShape(const Shape& shape, float x, float y) const
+{
+	if (x < shape.bounds[0] || x > shape.bounds[2] || y < shape.bounds[1] || y > shape.bounds[3]) {
+		return false;
+	}
+
+	if (shape.type == SHAPE_STROKE) {
+		float hw2 = shape.halfWidth * shape.halfWidth;
+		for (int c=shape.firstContour; c<shape.firstContour+shape.ncontours; c++) {
+			const Contour& contour = contours[c];
+			const ofVec2f* p = &points[contour.first];
+			if (contour.count == 1 && segmentDistanceSquared(p[0], p[0], x, y) <= hw2) {
+				return true;
+			}
+			int nsegs = contour.closed ? contour.count : contour.count-1;
+			for (int i=0; i<nsegs; i++) {
+				if (segmentDistanceSquared(p[i], p[(i+1) % contour.count], x, y) <= hw2) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	// nonzero winding over the oriented contours, every contour of a fill is
+	// implicitly closed
+	int winding = 0;
+	for (int c=shape.firstContour; c<shape.firstContour+shape.ncontours; c++) {
+		const Contour& contour = contours[c];
+		const ofVec2f* p = &points[contour.first];
+		for (int i=0; i<contour.count; i++) {
+			const ofVec2f& a = p[i];
+			const ofVec2f& b = p[(i+1) % contour.count];
+			if (a.y <= y) {
+				if (b.y > y && (b.x - a.x)*(y - a.y) - (x - a.x)*(b.y - a.y) > 0) {
+					winding++;
+				}
+			}
+			else if (b.y <= y && (b.x - a.x)*(y - a.y) - (x - a.x)*(b.y - a.y) < 0) {
+				winding--;
+			}
+		}
+	}
+	return winding != 0;
+}
@@ -0,0 +1,81 @@
+//
+//  ofxNanoVGShapeIndex.h
+//  ofxNanoVG
+//
+//  Bounding volume hierarchy over flattened shapes for hit-testing.
+//  Shapes added later are on top; pick() returns the id of the topmost shape
+//  whose fill contains the point or whose stroke passes within half its width
+//  of it. Like nvg__flattenPaths, fills turn every solid contour one way and
+//  every hole the other before testing for a nonzero winding number, so a
+//  reversed inner contour is only a hole if it is marked as one.
+//
+
+#ifndef __ofxNanoVG__ofxNanoVGShapeIndex__
+#define __ofxNanoVG__ofxNanoVGShapeIndex__
+
+#include "ofMain.h"
+
+class ofxNanoVGShapeIndex
+{
+public:
+	ofxNanoVGShapeIndex() : bBuilt(false), strokeTolerance(1), buildTime(0) {}
+
+	enum ShapeType {
+		SHAPE_FILL,
+		SHAPE_STROKE
+	};
+
+	struct Contour {
+		int first;		// index into the points passed to addShape
+		int count;
+		bool closed;
+		bool hole;		// set with nvgPathWinding(NVG_HOLE), fills only
+	};
+
+	void clear();
+	void addShape(int id, ShapeType type, float strokeWidth, const ofVec2f* points, const Contour* contours, int ncontours);
+	void build();
+
+	// id of the topmost shape at x, y or -1
+	int pick(float x, float y) const;
+
+	// extra distance accepted around strokes added after this call
+	void setStrokeTolerance(float tolerance) { strokeTolerance = tolerance; }
+	size_t size() const { return shapes.size(); }
+	// time the last build() took, in milliseconds
+	float getBuildTime() const { return buildTime; }
+
+private:
+	struct Shape {
+		int id;
+		ShapeType type;
+		float halfWidth;
+		float bounds[4];
+		int firstContour;
+		int ncontours;
+	};
+
+	struct Node {
+		float bounds[4];
+		int maxShape;	// highest shape index below this node, for pruning
+		int left;		// child node indices, -1 for leaves
+		int right;
+		int first;		// range in order
+		int count;
+	};
+
+	void orientContour(const Contour& contour);
+	bool hitShape(const Shape& shape, float x, float y) const;
+	int buildNode(int first, int count);
+
+	vector<Shape> shapes;
+	vector<Contour> contours;
+	vector<ofVec2f> points;
+	vector<Node> nodes;
+	vector<int> order;		// shape indices, grouped by leaf
+	bool bBuilt;
+	float strokeTolerance;
+	float buildTime;
+};
+
+#endif /* defined(__ofxNanoVG__ofxNanoVGShapeIndex__) */
@@ -0,0 +1,293 @@
+//
+//  ofxNanoVGSimd.cpp
+//  ofxNanoVG
+//
+//  Every kernel runs its vector loop over whole blocks of four and finishes
+//  the remainder with the scalar loop, which is also the fallback.
+//
+
+#include "ofxNanoVGSimd.h"
+#include <math.h>
+
+#if defined(OFXNANOVG_SSE2)
+#include <emmintrin.h>
+#elif defined(OFXNANOVG_NEON)
+#include <arm_neon.h>
+#endif
+
+bool ofxNanoVGSimd::bEnabled = true;
+
+const char* ofxNanoVGSimd::getInstructionSet()
+{
+#if defined(OFXNANOVG_SSE2)
+	return "SSE2";
+#elif defined(OFXNANOVG_NEON)
+	return "NEON";
+#else
+	return "scalar";
+#endif
+}
+
+void ofxNanoVGSimd::setEnabled(bool enabled)
+{
+	bEnabled = enabled;
+}
+
+void ofxNanoVGSimd::transformPoints(const float *t, const float *src, float *dst, int npts)
+{
+	int i = 0;
+
+#if defined(OFXNANOVG_SSE2)
+	__m128 t0 = _mm_set1_ps(t[0]), t1 = _mm_set1_ps(t[1]), t2 = _mm_set1_ps(t[2]);
+	__m128 t3 = _mm_set1_ps(t[3]), t4 = _mm_set1_ps(t[4]), t5 = _mm_set1_ps(t[5]);
+	for (; bEnabled && i+4<=npts; i+=4) {
+		__m128 v0 = _mm_loadu_ps(src + i*2);
+		__m128 v1 = _mm_loadu_ps(src + i*2 + 4);
+		__m128 xs = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 ys = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1));
+		__m128 tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, t0), _mm_mul_ps(ys, t2)), t4);
+		__m128 ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, t1), _mm_mul_ps(ys, t3)), t5);
+		_mm_storeu_ps(dst + i*2, _mm_unpacklo_ps(tx, ty));
+		_mm_storeu_ps(dst + i*2 + 4, _mm_unpackhi_ps(tx, ty));
+	}
+#elif defined(OFXNANOVG_NEON)
+	float32x4_t t0 = vdupq_n_f32(t[0]), t1 = vdupq_n_f32(t[1]), t2 = vdupq_n_f32(t[2]);
+	float32x4_t t3 = vdupq_n_f32(t[3]), t4 = vdupq_n_f32(t[4]), t5 = vdupq_n_f32(t[5]);
+	for (; bEnabled && i+4<=npts; i+=4) {
+		float32x4x2_t v = vld2q_f32(src + i*2);
+		float32x4x2_t r;
+		r.val[0] = vaddq_f32(vaddq_f32(vmulq_f32(v.val[0], t0), vmulq_f32(v.val[1], t2)), t4);
+		r.val[1] = vaddq_f32(vaddq_f32(vmulq_f32(v.val[0], t1), vmulq_f32(v.val[1], t3)), t5);
+		vst2q_f32(dst + i*2, r);
+	}
+#endif
+
+	for (; i<npts; i++) {
+		float x = src[i*2];
+		float y = src[i*2+1];
+		dst[i*2] = x*t[0] + y*t[2] + t[4];
+		dst[i*2+1] = x*t[1] + y*t[3] + t[5];
+	}
+}
+
+void ofxNanoVGSimd::segmentDirections(const float *p, int npts, bool closed, float *dirs)
+{
+	int nsegs = closed ? npts : npts-1;
+	int i = 0;
+
+	// blocks of segments that don't wrap around to the first point
+#if defined(OFXNANOVG_SSE2)
+	for (; bEnabled && i+4<npts; i+=4) {
+		__m128 a0 = _mm_loadu_ps(p + i*2);
+		__m128 a1 = _mm_loadu_ps(p + i*2 + 4);
+		__m128 b0 = _mm_loadu_ps(p + i*2 + 2);
+		__m128 b1 = _mm_loadu_ps(p + i*2 + 6);
+		__m128 dx = _mm_sub_ps(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)));
+		__m128 dy = _mm_sub_ps(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)));
+		__m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+		dx = _mm_div_ps(dx, len);
+		dy = _mm_div_ps(dy, len);
+		_mm_storeu_ps(dirs + i*2, _mm_unpacklo_ps(dx, dy));
+		_mm_storeu_ps(dirs + i*2 + 4, _mm_unpackhi_ps(dx, dy));
+	}
+#elif defined(OFXNANOVG_NEON) && defined(__aarch64__)
+	for (; bEnabled && i+4<npts; i+=4) {
+		float32x4x2_t a = vld2q_f32(p + i*2);
+		float32x4x2_t b = vld2q_f32(p + i*2 + 2);
+		float32x4_t dx = vsubq_f32(b.val[0], a.val[0]);
+		float32x4_t dy = vsubq_f32(b.val[1], a.val[1]);
+		float32x4_t len = vsqrtq_f32(vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy)));
+		float32x4x2_t r;
+		r.val[0] = vdivq_f32(dx, len);
+		r.val[1] = vdivq_f32(dy, len);
+		vst2q_f32(dirs + i*2, r);
+	}
+#endif
+
+	for (; i<nsegs; i++) {
+		int i1 = (i+1) % npts;
+		float dx = p[i1*2] - p[i*2];
+		float dy = p[i1*2+1] - p[i*2+1];
+		float len = sqrtf(dx*dx + dy*dy);
+		dirs[i*2] = dx / len;
+		dirs[i*2+1] = dy / len;
+	}
+}
+
+void ofxNanoVGSimd::crossSections(const float *p, const float *normals, int npts, float w, NVGvertex *dst)
+{
+	int i = 0;
+
+#if defined(OFXNANOVG_SSE2)
+	__m128 wv = _mm_set1_ps(w);
+	__m128 uvLeft = _mm_setr_ps(0, 1, 0, 1);
+	__m128 uvRight = _mm_set1_ps(1);
+	for (; bEnabled && i+2<=npts; i+=2) {
+		__m128 pv = _mm_loadu_ps(p + i*2);
+		__m128 nv = _mm_mul_ps(_mm_loadu_ps(normals + i*2), wv);
+		__m128 l = _mm_add_ps(pv, nv);
+		__m128 r = _mm_sub_ps(pv, nv);
+		float* out = (float*)(dst + i*2);
+		_mm_storeu_ps(out, _mm_movelh_ps(l, uvLeft));
+		_mm_storeu_ps(out + 4, _mm_movelh_ps(r, uvRight));
+		_mm_storeu_ps(out + 8, _mm_movehl_ps(uvLeft, l));
+		_mm_storeu_ps(out + 12, _mm_movehl_ps(uvRight, r));
+	}
+#elif defined(OFXNANOVG_NEON)
+	for (; bEnabled && i+4<=npts; i+=4) {
+		float32x4x2_t pv = vld2q_f32(p + i*2);
+		float32x4x2_t nv = vld2q_f32(normals + i*2);
+		float32x4x4_t l, r;
+		l.val[0] = vmlaq_n_f32(pv.val[0], nv.val[0], w);
+		l.val[1] = vmlaq_n_f32(pv.val[1], nv.val[1], w);
+		l.val[2] = vdupq_n_f32(0);
+		l.val[3] = vdupq_n_f32(1);
+		r.val[0] = vmlsq_n_f32(pv.val[0], nv.val[0], w);
+		r.val[1] = vmlsq_n_f32(pv.val[1], nv.val[1], w);
+		r.val[2] = vdupq_n_f32(1);
+		r.val[3] = vdupq_n_f32(1);
+		// interleave left and right vertices of each point
+		NVGvertex left[4], right[4];
+		vst4q_f32((float*)left, l);
+		vst4q_f32((float*)right, r);
+		for (int k=0; k<4; k++) {
+			dst[(i+k)*2] = left[k];
+			dst[(i+k)*2+1] = right[k];
+		}
+	}
+#endif
+
+	for (; i<npts; i++) {
+		float x = p[i*2];
+		float y = p[i*2+1];
+		NVGvertex l = { x + normals[i*2]*w, y + normals[i*2+1]*w, 0, 1 };
+		NVGvertex r = { x - normals[i*2]*w, y - normals[i*2+1]*w, 1, 1 };
+		dst[i*2] = l;
+		dst[i*2+1] = r;
+	}
+}
+
+void ofxNanoVGSimd::offsetSections(const float *p, const float *normals, int npts, const float *offsets, float *dst)
+{
+	int i = 0;
+
+#if defined(OFXNANOVG_SSE2)
+	__m128 off = _mm_loadu_ps(offsets);
+	for (; bEnabled && i<npts; i++) {
+		__m128 xs = _mm_add_ps(_mm_set1_ps(p[i*2]), _mm_mul_ps(_mm_set1_ps(normals[i*2]), off));
+		__m128 ys = _mm_add_ps(_mm_set1_ps(p[i*2+1]), _mm_mul_ps(_mm_set1_ps(normals[i*2+1]), off));
+		_mm_storeu_ps(dst + i*8, xs);
+		_mm_storeu_ps(dst + i*8 + 4, ys);
+	}
+#elif defined(OFXNANOVG_NEON)
+	float32x4_t off = vld1q_f32(offsets);
+	for (; bEnabled && i<npts; i++) {
+		vst1q_f32(dst + i*8, vmlaq_n_f32(vdupq_n_f32(p[i*2]), off, normals[i*2]));
+		vst1q_f32(dst + i*8 + 4, vmlaq_n_f32(vdupq_n_f32(p[i*2+1]), off, normals[i*2+1]));
+	}
+#endif
+
+	for (; i<npts; i++) {
+		for (int k=0; k<4; k++) {
+			dst[i*8+k] = p[i*2] + normals[i*2]*offsets[k];
+			dst[i*8+4+k] = p[i*2+1] + normals[i*2+1]*offsets[k];
+		}
+	}
+}
+
+void ofxNanoVGSimd::vertexBounds(const NVGvertex *verts, int nverts, float *bounds)
+{
+	bounds[0] = bounds[1] = 1e30f;
+	bounds[2] = bounds[3] = -1e30f;
+	int i = 0;
+
+#if defined(OFXNANOVG_SSE2)
+	if (bEnabled && nverts > 0) {
+		__m128 mn = _mm_loadu_ps((const float*)verts);
+		__m128 mx = mn;
+		for (i=1; i<nverts; i++) {
+			__m128 v = _mm_loadu_ps((const float*)(verts + i));
+			mn = _mm_min_ps(mn, v);
+			mx = _mm_max_ps(mx, v);
+		}
+		float lo[4], hi[4];
+		_mm_storeu_ps(lo, mn);
+		_mm_storeu_ps(hi, mx);
+		bounds[0] = lo[0];
+		bounds[1] = lo[1];
+		bounds[2] = hi[0];
+		bounds[3] = hi[1];
+	}
+#elif defined(OFXNANOVG_NEON)
+	if (bEnabled && nverts > 0) {
+		float32x4_t mn = vld1q_f32((const float*)verts);
+		float32x4_t mx = mn;
+		for (i=1; i<nverts; i++) {
+			float32x4_t v = vld1q_f32((const float*)(verts + i));
+			mn = vminq_f32(mn, v);
+			mx = vmaxq_f32(mx, v);
+		}
+		bounds[0] = vgetq_lane_f32(mn, 0);
+		bounds[1] = vgetq_lane_f32(mn, 1);
+		bounds[2] = vgetq_lane_f32(mx, 0);
+		bounds[3] = vgetq_lane_f32(mx, 1);
+	}
+#endif
+
+	for (; i<nverts; i++) {
+		bounds[0] = fminf(bounds[0], verts[i].x);
+		bounds[1] = fminf(bounds[1], verts[i].y);
+		bounds[2] = fmaxf(bounds[2], verts[i].x);
+		bounds[3] = fmaxf(bounds[3], verts[i].y);
+	}
+}
+
+void ofxNanoVGSimd::flattenBezier(const float *p0, const float *p1, const float *p2, const float *p3, int n, float *dst)
+{
+	int i = 0;
+
+#if defined(OFXNANOVG_SSE2)
+	__m128 nv = _mm_set1_ps((float)n);
+	__m128 one = _mm_set1_ps(1);
+	__m128 three = _mm_set1_ps(3);
+	for (; bEnabled && i+4<=n; i+=4) {
+		__m128 t = _mm_div_ps(_mm_setr_ps(i+1, i+2, i+3, i+4), nv);
+		__m128 mt = _mm_sub_ps(one, t);
+		__m128 b0 = _mm_mul_ps(_mm_mul_ps(mt, mt), mt);
+		__m128 b1 = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(three, mt), mt), t);
+		__m128 b2 = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(three, mt), t), t);
+		__m128 b3 = _mm_mul_ps(_mm_mul_ps(t, t), t);
+		__m128 xs = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p0[0]), b0), _mm_mul_ps(_mm_set1_ps(p1[0]), b1)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p2[0]), b2), _mm_mul_ps(_mm_set1_ps(p3[0]), b3)));
+		__m128 ys = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p0[1]), b0), _mm_mul_ps(_mm_set1_ps(p1[1]), b1)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p2[1]), b2), _mm_mul_ps(_mm_set1_ps(p3[1]), b3)));
+		_mm_storeu_ps(dst + i*2, _mm_unpacklo_ps(xs, ys));
+		_mm_storeu_ps(dst + i*2 + 4, _mm_unpackhi_ps(xs, ys));
+	}
+#elif defined(OFXNANOVG_NEON)
+	for (; bEnabled && i+4<=n; i+=4) {
+		float idx[4] = { (float)(i+1), (float)(i+2), (float)(i+3), (float)(i+4) };
+		float32x4_t t = vmulq_n_f32(vld1q_f32(idx), 1.0f / n);
+		float32x4_t mt = vsubq_f32(vdupq_n_f32(1), t);
+		float32x4_t b0 = vmulq_f32(vmulq_f32(mt, mt), mt);
+		float32x4_t b1 = vmulq_f32(vmulq_n_f32(vmulq_f32(mt, mt), 3), t);
+		float32x4_t b2 = vmulq_f32(vmulq_n_f32(vmulq_f32(mt, t), 3), t);
+		float32x4_t b3 = vmulq_f32(vmulq_f32(t, t), t);
+		float32x4x2_t r;
+		r.val[0] = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(b0, p0[0]), b1, p1[0]), b2, p2[0]), b3, p3[0]);
+		r.val[1] = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(b0, p0[1]), b1, p1[1]), b2, p2[1]), b3, p3[1]);
+		vst2q_f32(dst + i*2, r);
+	}
+#endif
+
+	for (; i<n; i++) {
+		float t = (float)(i+1) / n;
+		float mt = 1-t;
+		float b0 = mt*mt*mt;
+		float b1 = 3*mt*mt*t;
+		float b2 = 3*mt*t*t;
+		float b3 = t*t*t;
+		dst[i*2] = p0[0]*b0 + p1[0]*b1 + p2[0]*b2 + p3[0]*b3;
+		dst[i*2+1] = p0[1]*b0 + p1[1]*b1 + p2[1]*b2 + p3[1]*b3;
+	}
+}
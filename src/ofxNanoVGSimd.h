@@ -0,0 +1,64 @@
+//
+//  ofxNanoVGSimd.h
+//  ofxNanoVG
+//
+//  Vector kernels for the per-point loops ofxNanoVG runs itself (the fast
+//  stroke paths, partial redraw bounds, sprites and the picking recorder).
+//  Only these are vectorized: NanoVG's flattening, nvg__expandStroke and
+//  nvg__expandFill in libs/nanovg are upstream code and stay scalar, so
+//  regular fills and strokes don't get faster with this switch.
+//
+//  Points are x/y interleaved in memory and processed four at a time as
+//  separate x and y lanes, offsetSections instead puts the four offsets of
+//  one point in the lanes. SSE2 on x86, NEON on ARM, plain C++ elsewhere or
+//  when OFXNANOVG_NO_SIMD is defined. There is no AVX2 version, it would
+//  need a runtime CPU check and the polylines are mostly too short for
+//  blocks of eight. Results match the scalar code up to float rounding.
+//
+
+#ifndef __ofxNanoVG__ofxNanoVGSimd__
+#define __ofxNanoVG__ofxNanoVGSimd__
+
+#include "nanovg.h"
+
+#if !defined(OFXNANOVG_NO_SIMD)
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define OFXNANOVG_SSE2
+	#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+		#define OFXNANOVG_NEON
+	#endif
+#endif
+
+class ofxNanoVGSimd
+{
+public:
+	// "SSE2", "NEON" or "scalar"
+	static const char* getInstructionSet();
+	// run the scalar loops even where vector code was compiled in, to
+	// compare results and timings (not thread safe, set it between frames)
+	static void setEnabled(bool enabled);
+	static bool isEnabled() { return bEnabled; }
+
+	// dst = xform * src for npts points, like nvgTransformPoint. dst may be src.
+	static void transformPoints(const float* xform, const float* src, float* dst, int npts);
+
+	// unit direction of every segment of the polyline p, nsegs = closed ? npts : npts-1
+	static void segmentDirections(const float* p, int npts, bool closed, float* dirs);
+
+	// two strip vertices per point, p + normal*w (u=0) and p - normal*w (u=1), v=1
+	static void crossSections(const float* p, const float* normals, int npts, float w, NVGvertex* dst);
+
+	// p + normal*offsets[k] for the 4 offsets of every point, as 4 x then 4 y per point
+	static void offsetSections(const float* p, const float* normals, int npts, const float* offsets, float* dst);
+
+	// min x, min y, max x, max y of the vertex positions
+	static void vertexBounds(const NVGvertex* verts, int nverts, float* bounds);
+
+	// points at t = 1/n, 2/n ... 1 on the cubic bezier p0 (x, y) .. p3
+	static void flattenBezier(const float* p0, const float* p1, const float* p2, const float* p3, int n, float* dst);
+
+private:
+	static bool bEnabled;
+};
+
+#endif /* defined(__ofxNanoVG__ofxNanoVGSimd__) */
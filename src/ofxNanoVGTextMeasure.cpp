@@ -0,0 +1,370 @@
+//
+//  ofxNanoVGTextMeasure.cpp
+//  ofxNanoVG
+//
+
+#include "ofxNanoVGTextMeasure.h"
+
+// declarations only, the implementation is compiled into nanovg.c
+extern "C" {
+#include "fontstash.h"
+}
+
+#define MEASURE_ATLAS_SIZE 512
+#define MEASURE_JOBS_PER_TASK 32
+
+enum CodepointType {
+	CODEPOINT_SPACE,
+	CODEPOINT_NEWLINE,
+	CODEPOINT_CHAR,
+	CODEPOINT_CJK_CHAR
+};
+
+ofxNanoVGTextMeasure::ofxNanoVGTextMeasure() :
+	numThreads(0),
+	pixelRatio(1)
+{
+	setNumThreads(0);
+}
+
+ofxNanoVGTextMeasure::~ofxNanoVGTextMeasure()
+{
+	for (Worker* w : workers) {
+		fonsDeleteInternal(w->fs);
+		delete w;
+	}
+}
+
+void ofxNanoVGTextMeasure::setNumThreads(int threads)
+{
+	if (threads <= 0) {
+		threads = max((int)std::thread::hardware_concurrency(), 1);
+	}
+	numThreads = threads;
+}
+
+ofxNanoVGTextMeasure::Worker* ofxNanoVGTextMeasure::getWorker(int index)
+{
+	while ((int)workers.size() <= index) {
+		FONSparams params;
+		memset(&params, 0, sizeof(params));
+		params.width = MEASURE_ATLAS_SIZE;
+		params.height = MEASURE_ATLAS_SIZE;
+		params.flags = FONS_ZERO_TOPLEFT;
+
+		Worker* w = new Worker();
+		w->fs = fonsCreateInternal(&params);
+		// glyph bitmaps are never used here, just start over when the atlas fills up
+		fonsSetErrorCallback(w->fs, handleFonsError, w->fs);
+		workers.push_back(w);
+	}
+
+	return workers[index];
+}
+
+void ofxNanoVGTextMeasure::handleFonsError(void* uptr, int error, int val)
+{
+	if (error == FONS_ATLAS_FULL) {
+		fonsResetAtlas((FONScontext*)uptr, MEASURE_ATLAS_SIZE, MEASURE_ATLAS_SIZE);
+	}
+}
+
+vector<ofxNanoVGTextMeasure::Result> ofxNanoVGTextMeasure::measure(const vector<Job>& jobs)
+{
+	std::lock_guard<std::mutex> lock(measureMutex);
+
+	vector<Result> results(jobs.size());
+	int tasks = (int)((jobs.size() + MEASURE_JOBS_PER_TASK - 1) / MEASURE_JOBS_PER_TASK);
+
+	// the pool's threads are started by the first call that has work for them
+	if (tasks > 1) {
+		pool.setNumThreads(numThreads);
+	}
+	getWorker(pool.getNumThreads() - 1);
+
+	// tasks of consecutive jobs, each measured with the fontstash of its thread
+	pool.parallelFor(tasks, [&](int task, int thread) {
+		size_t first = (size_t)task * MEASURE_JOBS_PER_TASK;
+		size_t last = min(first + MEASURE_JOBS_PER_TASK, jobs.size());
+		for (size_t i=first; i<last; i++) {
+			measureJob(workers[thread], jobs[i], results[i]);
+		}
+	});
+
+	return results;
+}
+
+ofxNanoVGTextMeasure::Result ofxNanoVGTextMeasure::measure(const Job& job)
+{
+	std::lock_guard<std::mutex> lock(measureMutex);
+
+	Result result;
+	measureJob(getWorker(0), job, result);
+	return result;
+}
+
+bool ofxNanoVGTextMeasure::setFont(Worker* worker, const Job& job)
+{
+	const ofxNanoVG::Font* font = job.font;
+	if (font == NULL || !font->isLoaded() || font->data == NULL) {
+		return false;
+	}
+
+	int fontId;
+	auto it = worker->fontIds.find(font->data);
+	if (it == worker->fontIds.end()) {
+		fontId = fonsAddFontMem(worker->fs, ofToString((size_t)font->data).c_str(), const_cast<unsigned char*>(font->data), font->dataSize, 0);
+		worker->fontIds[font->data] = fontId;
+	}
+	else {
+		fontId = it->second;
+	}
+	if (fontId < 0) {
+		return false;
+	}
+
+	// same state nanovg sets up for measuring
+	fonsClearState(worker->fs);
+	fonsSetSize(worker->fs, job.fontSize * pixelRatio);
+	fonsSetSpacing(worker->fs, font->letterSpacing * pixelRatio);
+	fonsSetBlur(worker->fs, 0);
+	fonsSetAlign(worker->fs, job.align);
+	fonsSetFont(worker->fs, fontId);
+
+	return true;
+}
+
+// same as nvgTextBounds and nvgTextBoxBounds
+void ofxNanoVGTextMeasure::measureJob(Worker* worker, const Job& job, Result& result)
+{
+	result.bounds = ofRectangle(job.x, job.y, 0, 0);
+	result.advance = 0;
+	result.lines.clear();
+
+	if (!setFont(worker, job)) {
+		return;
+	}
+
+	float scale = pixelRatio;
+	float invscale = 1.0f / scale;
+	const char* str = job.text.c_str();
+	const char* end = str + job.text.size();
+
+	if (job.breakRowWidth <= 0) {
+		float bounds[4];
+		float width = fonsTextBounds(worker->fs, job.x*scale, job.y*scale, str, end, bounds);
+		fonsLineBounds(worker->fs, job.y*scale, &bounds[1], &bounds[3]);
+		result.advance = width * invscale;
+		result.bounds = ofRectangle(bounds[0]*invscale, bounds[1]*invscale, (bounds[2]-bounds[0])*invscale, (bounds[3]-bounds[1])*invscale);
+
+		Line line;
+		line.start = 0;
+		line.end = line.next = job.text.size();
+		line.y = 0;
+		line.width = result.advance;
+		line.minx = bounds[0]*invscale - job.x;
+		line.maxx = bounds[2]*invscale - job.x;
+		result.lines.push_back(line);
+		return;
+	}
+
+	int halign = job.align & (ofxNanoVG::NVG_ALIGN_LEFT | ofxNanoVG::NVG_ALIGN_CENTER | ofxNanoVG::NVG_ALIGN_RIGHT);
+	int valign = job.align & (ofxNanoVG::NVG_ALIGN_TOP | ofxNanoVG::NVG_ALIGN_MIDDLE | ofxNanoVG::NVG_ALIGN_BOTTOM | ofxNanoVG::NVG_ALIGN_BASELINE);
+	float lineHeight = job.lineHeight == -1 ? job.font->lineHeight : job.lineHeight;
+
+	fonsSetAlign(worker->fs, ofxNanoVG::NVG_ALIGN_LEFT | valign);
+
+	float lineh, rminy, rmaxy;
+	fonsVertMetrics(worker->fs, NULL, NULL, &lineh);
+	fonsLineBounds(worker->fs, 0, &rminy, &rmaxy);
+	lineh *= invscale;
+	rminy *= invscale;
+	rmaxy *= invscale;
+
+	breakLines(worker, job, job.breakRowWidth, result.lines);
+
+	float minx = job.x, maxx = job.x, miny = job.y, maxy = job.y;
+	float y = 0;
+	for (Line& line : result.lines) {
+		float dx = 0;
+		if (halign & ofxNanoVG::NVG_ALIGN_CENTER) {
+			dx = job.breakRowWidth*0.5f - line.width*0.5f;
+		}
+		else if (halign & ofxNanoVG::NVG_ALIGN_RIGHT) {
+			dx = job.breakRowWidth - line.width;
+		}
+		line.minx += dx;
+		line.maxx += dx;
+		line.y = y;
+
+		minx = min(minx, job.x + line.minx);
+		maxx = max(maxx, job.x + line.maxx);
+		miny = min(miny, job.y + y + rminy);
+		maxy = max(maxy, job.y + y + rmaxy);
+		y += lineh * lineHeight;
+	}
+
+	result.bounds = ofRectangle(minx, miny, maxx-minx, maxy-miny);
+}
+
+static CodepointType getCodepointType(unsigned int codepoint, unsigned int prev)
+{
+	switch (codepoint) {
+		case 9:			// \t
+		case 11:		// \v
+		case 12:		// \f
+		case 32:		// space
+		case 0x00a0:	// NBSP
+			return CODEPOINT_SPACE;
+		case 10:		// \n
+			return prev == 13 ? CODEPOINT_SPACE : CODEPOINT_NEWLINE;
+		case 13:		// \r
+			return prev == 10 ? CODEPOINT_SPACE : CODEPOINT_NEWLINE;
+		case 0x0085:	// NEL
+			return CODEPOINT_NEWLINE;
+		default:
+			// CJK text can break between any two characters
+			if ((codepoint >= 0x4E00 && codepoint <= 0x9FFF) ||
+				(codepoint >= 0x3000 && codepoint <= 0x30FF) ||
+				(codepoint >= 0xFF00 && codepoint <= 0xFFEF) ||
+				(codepoint >= 0x1100 && codepoint <= 0x11FF) ||
+				(codepoint >= 0x3130 && codepoint <= 0x318F) ||
+				(codepoint >= 0xAC00 && codepoint <= 0xD7AF)) {
+				return CODEPOINT_CJK_CHAR;
+			}
+			return CODEPOINT_CHAR;
+	}
+}
+
+// same rules as nvgTextBreakLines
+void ofxNanoVGTextMeasure::breakLines(Worker* worker, const Job& job, float breakRowWidth, vector<Line>& lines)
+{
+	const char* str = job.text.c_str();
+	const char* end = str + job.text.size();
+	if (str == end) {
+		return;
+	}
+
+	float scale = pixelRatio;
+	float invscale = 1.0f / scale;
+	breakRowWidth *= scale;
+
+	FONStextIter iter;
+	FONSquad q;
+	float rowStartX = 0, rowWidth = 0, rowMinX = 0, rowMaxX = 0;
+	const char* rowStart = NULL;
+	const char* rowEnd = NULL;
+	const char* wordStart = NULL;
+	float wordStartX = 0, wordMinX = 0;
+	const char* breakEnd = NULL;
+	float breakWidth = 0, breakMaxX = 0;
+	CodepointType type = CODEPOINT_SPACE, ptype = CODEPOINT_SPACE;
+	unsigned int pcodepoint = 0;
+
+	auto addLine = [&](const char* s, const char* e, const char* next, float width, float minx, float maxx) {
+		Line line;
+		line.start = s - str;
+		line.end = e - str;
+		line.next = next - str;
+		line.y = 0;
+		line.width = width * invscale;
+		line.minx = minx * invscale;
+		line.maxx = maxx * invscale;
+		lines.push_back(line);
+	};
+
+	fonsTextIterInit(worker->fs, &iter, 0, 0, str, end, FONS_GLYPH_BITMAP_OPTIONAL);
+	while (fonsTextIterNext(worker->fs, &iter, &q)) {
+		type = getCodepointType(iter.codepoint, pcodepoint);
+		bool isChar = type == CODEPOINT_CHAR || type == CODEPOINT_CJK_CHAR;
+
+		if (type == CODEPOINT_NEWLINE) {
+			// always break on new lines
+			addLine(rowStart != NULL ? rowStart : iter.str, rowEnd != NULL ? rowEnd : iter.str, iter.next, rowWidth, rowMinX, rowMaxX);
+			breakEnd = rowStart;
+			breakWidth = 0;
+			breakMaxX = 0;
+			// skip white space at the beginning of the row
+			rowStart = NULL;
+			rowEnd = NULL;
+			rowWidth = 0;
+			rowMinX = rowMaxX = 0;
+		}
+		else if (rowStart == NULL) {
+			if (isChar) {
+				// the current char starts the row
+				rowStartX = iter.x;
+				rowStart = iter.str;
+				rowEnd = iter.next;
+				rowWidth = iter.nextx - rowStartX;
+				rowMinX = q.x0 - rowStartX;
+				rowMaxX = q.x1 - rowStartX;
+				wordStart = iter.str;
+				wordStartX = iter.x;
+				wordMinX = q.x0 - rowStartX;
+				breakEnd = rowStart;
+				breakWidth = 0;
+				breakMaxX = 0;
+			}
+		}
+		else {
+			float nextWidth = iter.nextx - rowStartX;
+			bool pisChar = ptype == CODEPOINT_CHAR || ptype == CODEPOINT_CJK_CHAR;
+
+			// last non white space character
+			if (isChar) {
+				rowEnd = iter.next;
+				rowWidth = iter.nextx - rowStartX;
+				rowMaxX = q.x1 - rowStartX;
+			}
+			// last end of a word
+			if ((pisChar && type == CODEPOINT_SPACE) || type == CODEPOINT_CJK_CHAR) {
+				breakEnd = iter.str;
+				breakWidth = rowWidth;
+				breakMaxX = rowMaxX;
+			}
+			// last beginning of a word
+			if ((ptype == CODEPOINT_SPACE && isChar) || type == CODEPOINT_CJK_CHAR) {
+				wordStart = iter.str;
+				wordStartX = iter.x;
+				wordMinX = q.x0 - rowStartX;
+			}
+
+			if (isChar && nextWidth > breakRowWidth) {
+				if (breakEnd == rowStart) {
+					// the word is longer than the row, break it here
+					addLine(rowStart, iter.str, iter.str, rowWidth, rowMinX, rowMaxX);
+					rowStartX = iter.x;
+					rowStart = iter.str;
+					rowEnd = iter.next;
+					rowWidth = iter.nextx - rowStartX;
+					rowMinX = q.x0 - rowStartX;
+					rowMaxX = q.x1 - rowStartX;
+					wordStart = iter.str;
+					wordStartX = iter.x;
+					wordMinX = q.x0 - rowStartX;
+				}
+				else {
+					// break after the last word and start the row with the current one
+					addLine(rowStart, breakEnd, wordStart, breakWidth, rowMinX, breakMaxX);
+					rowStartX = wordStartX;
+					rowStart = wordStart;
+					rowEnd = iter.next;
+					rowWidth = iter.nextx - rowStartX;
+					rowMinX = wordMinX;
+					rowMaxX = q.x1 - rowStartX;
+				}
+				breakEnd = rowStart;
+				breakWidth = 0;
+				breakMaxX = 0;
+			}
+		}
+
+		pcodepoint = iter.codepoint;
+		ptype = type;
+	}
+
+	if (rowStart != NULL) {
+		addLine(rowStart, rowEnd, end, rowWidth, rowMinX, rowMaxX);
+	}
+}
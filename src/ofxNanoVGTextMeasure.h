@@ -0,0 +1,86 @@
+//
+//  ofxNanoVGTextMeasure.h
+//  ofxNanoVG
+//
+//  Measures text without the NanoVG context, so layout can run on any
+//  thread before drawing. Jobs are spread over a pool of persistent
+//  threads, each with its own fontstash instance over the shared,
+//  read-only font data of ofxNanoVG::Font.
+//  Results match getTextBounds / getTextBoxBounds at the same pixel ratio.
+//
+
+#ifndef __ofxNanoVG__ofxNanoVGTextMeasure__
+#define __ofxNanoVG__ofxNanoVGTextMeasure__
+
+#include "ofxNanoVG.h"
+#include "ofxNanoVGThreadPool.h"
+
+struct FONScontext;
+
+class ofxNanoVGTextMeasure
+{
+public:
+	ofxNanoVGTextMeasure();
+	~ofxNanoVGTextMeasure();
+
+	struct Job {
+		Job() : font(NULL), fontSize(12), x(0), y(0), breakRowWidth(0), lineHeight(-1),
+			align(ofxNanoVG::NVG_ALIGN_LEFT | ofxNanoVG::NVG_ALIGN_BASELINE) {}
+		const ofxNanoVG::Font* font;
+		float fontSize;
+		string text;
+		float x, y;
+		float breakRowWidth;	// <= 0 measures a single line
+		float lineHeight;		// -1 uses the font's line height
+		int align;				// ofxNanoVG::TextHorizontalAlign | ofxNanoVG::TextVerticalAlign
+	};
+
+	struct Line {
+		size_t start;	// byte offsets into Job::text
+		size_t end;
+		size_t next;	// where the following line starts
+		float y;		// baseline offset from Job::y
+		float width;
+		float minx, maxx;
+	};
+
+	struct Result {
+		ofRectangle bounds;
+		float advance;	// horizontal advance of a single line
+		vector<Line> lines;
+	};
+
+	// number of worker threads, 0 uses the hardware concurrency
+	void setNumThreads(int threads);
+	// match the devicePixelRatio passed to beginFrame
+	void setPixelRatio(float ratio) { pixelRatio = ratio; }
+
+	// measure all jobs in parallel. Fonts must be loaded and not change while measuring.
+	vector<Result> measure(const vector<Job>& jobs);
+	Result measure(const Job& job);
+
+private:
+	struct Worker {
+		FONScontext* fs;
+		std::map<const unsigned char*, int> fontIds;
+	};
+
+	Worker* getWorker(int index);
+	void measureJob(Worker* worker, const Job& job, Result& result);
+	void breakLines(Worker* worker, const Job& job, float breakRowWidth, vector<Line>& lines);
+	bool setFont(Worker* worker, const Job& job);
+
+	static void handleFonsError(void* uptr, int error, int val);
+
+	vector<Worker*> workers;		// one per pool thread
+	ofxNanoVGThreadPool pool;
+	int numThreads;
+	float pixelRatio;
+	std::mutex measureMutex;
+
+	// make sure there are no copies
+	ofxNanoVGTextMeasure(ofxNanoVGTextMeasure const&);
+	void operator=(ofxNanoVGTextMeasure const&);
+};
+
+#endif /* defined(__ofxNanoVG__ofxNanoVGTextMeasure__) */
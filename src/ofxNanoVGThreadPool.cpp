@@ -0,0 +1,122 @@
+//
+//  ofxNanoVGThreadPool.cpp
+//  ofxNanoVG
+//
+
+#include "ofxNanoVGThreadPool.h"
+
+ofxNanoVGThreadPool::ofxNanoVGThreadPool() :
+	task(NULL),
+	generation(0),
+	busy(0),
+	bQuit(false)
+{
+	queues.reset(new Queue[1]());
+	queues[0].next = 0;
+	queues[0].end = 0;
+}
+
+ofxNanoVGThreadPool::~ofxNanoVGThreadPool()
+{
+	stop();
+}
+
+void ofxNanoVGThreadPool::setNumThreads(int count)
+{
+	if (count <= 0) {
+		count = max(1u, std::thread::hardware_concurrency());
+	}
+	if (count == getNumThreads()) {
+		return;
+	}
+
+	stop();
+	queues.reset(new Queue[count]());
+	for (int t=0; t<count; t++) {
+		queues[t].next = 0;
+		queues[t].end = 0;
+	}
+	bQuit = false;
+	// new workers wait for the next parallelFor, not one that ran before them
+	for (int i=1; i<count; i++) {
+		workers.push_back(std::thread(&ofxNanoVGThreadPool::workerLoop, this, i, generation));
+	}
+}
+
+void ofxNanoVGThreadPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		bQuit = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+}
+
+void ofxNanoVGThreadPool::parallelFor(int count, const std::function<void (int, int)> &f)
+{
+	int nthreads = getNumThreads();
+	if (nthreads == 1 || count < 2) {
+		for (int i=0; i<count; i++) {
+			f(i, 0);
+		}
+		return;
+	}
+
+	// contiguous ranges keep neighbouring items (and their output) on one thread
+	for (int t=0; t<nthreads; t++) {
+		queues[t].next = (int)((long long)count * t / nthreads);
+		queues[t].end = (int)((long long)count * (t+1) / nthreads);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task = &f;
+		busy = workers.size();
+		generation++;
+	}
+	wake.notify_all();
+
+	run(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this]() { return busy == 0; });
+	task = NULL;
+}
+
+void ofxNanoVGThreadPool::workerLoop(int self, unsigned int seen)
+{
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&]() { return bQuit || generation != seen; });
+			if (bQuit) {
+				return;
+			}
+			seen = generation;
+		}
+
+		run(self);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--busy == 0) {
+			done.notify_one();
+		}
+	}
+}
+
+// drain the own queue, then steal from the others in turn
+void ofxNanoVGThreadPool::run(int self)
+{
+	int nthreads = getNumThreads();
+	for (int k=0; k<nthreads; k++) {
+		Queue& queue = queues[(self + k) % nthreads];
+		int i;
+		while ((i = queue.next.fetch_add(1)) < queue.end) {
+			(*task)(i, self);
+		}
+	}
+}
@@ -0,0 +1,54 @@
+//
+//  ofxNanoVGThreadPool.h
+//  ofxNanoVG
+//
+//  Persistent worker threads for data parallel loops. parallelFor splits
+//  the index range into one queue per thread; a thread that drains its own
+//  queue steals the remaining indices of the others, so uneven items (long
+//  and short paths) still keep every thread busy. The calling thread works
+//  too and the call returns when every index is done.
+//
+
+#ifndef __ofxNanoVG__ofxNanoVGThreadPool__
+#define __ofxNanoVG__ofxNanoVGThreadPool__
+
+#include "ofMain.h"
+
+class ofxNanoVGThreadPool
+{
+public:
+	ofxNanoVGThreadPool();
+	~ofxNanoVGThreadPool();
+
+	// threads including the caller's, 0 uses one per core, 1 runs on the caller
+	void setNumThreads(int count);
+	int getNumThreads() const { return workers.size() + 1; }
+
+	// call task(i, thread) for every i in [0, count), thread is the index
+	// (0 for the caller) of the thread running it, for per-thread scratch
+	// data. Not reentrant.
+	void parallelFor(int count, const std::function<void(int, int)>& task);
+
+private:
+	struct Queue {
+		std::atomic<int> next;
+		int end;
+	};
+
+	void stop();
+	// seen is the generation of the last parallelFor before the worker started
+	void workerLoop(int self, unsigned int seen);
+	void run(int self);
+
+	vector<std::thread> workers;
+	std::unique_ptr<Queue[]> queues;
+	const std::function<void(int, int)>* task;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	unsigned int generation;
+	int busy;
+	bool bQuit;
+};
+
+#endif /* defined(__ofxNanoVG__ofxNanoVGThreadPool__) */
@@ -0,0 +1,1028 @@
+//
+//  ofxNanoVGTrace.cpp
+//  ofxNanoVG
+//
+
+#include "ofxNanoVGTrace.h"
+#include <chrono>
+
+static const char* opNames[ofxNanoVGTrace::OP_COUNT] = {
+	"", "beginFrame", "endFrame", "save", "restore", "transform", "scissor",
+	"intersectScissor", "resetScissor", "beginPath", "moveTo", "lineTo",
+	"bezierTo", "rect", "roundedRect", "ellipse", "arc", "fill", "stroke",
+	"strokeWidth", "lineCap", "lineJoin", "fillColor", "strokeColor",
+	"fillPaint", "strokePaint", "font", "image", "deleteImage", "fontFace",
+	"fontSize", "letterSpacing", "lineHeight", "textAlign", "fontBlur", "text",
+	"textBox", "directStroke", "directTriangles", "pathWinding"
+};
+
+// serialized sizes
+#define PAINT_SIZE (18*sizeof(float) + sizeof(int32_t))
+#define SCISSOR_SIZE (8*sizeof(float))
+#define VERTEX_SIZE (4*sizeof(float))
+
+const char* ofxNanoVGTrace::getOpName(int op)
+{
+	if (op <= 0 || op >= OP_COUNT) {
+		return "unknown";
+	}
+	return opNames[op];
+}
+
+/*******************************************************************************
+ * Recording
+ ******************************************************************************/
+
+ofxNanoVGTrace::ofxNanoVGTrace() :
+	file(NULL),
+	written(0),
+	opStart(0)
+{
+	nvgTransformIdentity(xform);
+}
+
+ofxNanoVGTrace::~ofxNanoVGTrace()
+{
+	close();
+}
+
+bool ofxNanoVGTrace::open(const string &filename)
+{
+	close();
+
+	file = fopen(ofToDataPath(filename).c_str(), "wb");
+	if (file == NULL) {
+		ofLogError("ofxNanoVGTrace::open", "could not open trace file: %s", filename.c_str());
+		return false;
+	}
+
+	written = 0;
+	fonts.clear();
+	images.clear();
+	buffer.clear();
+	put(MAGIC);
+	put(VERSION);
+	flush();
+	return true;
+}
+
+void ofxNanoVGTrace::close()
+{
+	if (file == NULL) {
+		return;
+	}
+
+	flush();
+	fclose(file);
+	file = NULL;
+}
+
+void ofxNanoVGTrace::flush()
+{
+	if (file == NULL || buffer.empty()) {
+		return;
+	}
+
+	if (fwrite(&buffer[0], 1, buffer.size(), file) != buffer.size()) {
+		ofLogError("ofxNanoVGTrace") << "error writing trace, closing it";
+		buffer.clear();
+		fclose(file);
+		file = NULL;
+		return;
+	}
+	written += buffer.size();
+	buffer.clear();
+}
+
+void ofxNanoVGTrace::beginOp(Op op)
+{
+	opStart = buffer.size();
+	put((uint8_t)op);
+	put((uint32_t)0);
+}
+
+// patch the payload size of the record opened by beginOp
+void ofxNanoVGTrace::endOp()
+{
+	uint32_t size = buffer.size() - opStart - 5;
+	memcpy(&buffer[opStart+1], &size, sizeof(size));
+}
+
+void ofxNanoVGTrace::putBytes(const void *data, size_t size)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	buffer.insert(buffer.end(), p, p + size);
+}
+
+void ofxNanoVGTrace::putPaint(const NVGpaint &paint)
+{
+	putBytes(paint.xform, sizeof(float)*6);
+	putBytes(paint.extent, sizeof(float)*2);
+	put(paint.radius);
+	put(paint.feather);
+	putBytes(paint.innerColor.rgba, sizeof(float)*4);
+	putBytes(paint.outerColor.rgba, sizeof(float)*4);
+	put((int32_t)paint.image);
+}
+
+void ofxNanoVGTrace::putFloats(float a, float b)
+{
+	put(a);
+	put(b);
+}
+
+void ofxNanoVGTrace::putFloats(float a, float b, float c, float d)
+{
+	put(a);
+	put(b);
+	put(c);
+	put(d);
+}
+
+void ofxNanoVGTrace::beginFrame(int width, int height, float devicePixelRatio, bool nested)
+{
+	// nvgBeginFrame resets the state, transform included
+	nvgTransformIdentity(xform);
+	xformStack.clear();
+	if (!nested) {
+		images.clear();
+	}
+
+	beginOp(OP_BEGIN_FRAME);
+	put((int32_t)width);
+	put((int32_t)height);
+	put(devicePixelRatio);
+	put((uint8_t)nested);
+	endOp();
+}
+
+void ofxNanoVGTrace::endFrame()
+{
+	beginOp(OP_END_FRAME);
+	endOp();
+	flush();
+}
+
+void ofxNanoVGTrace::save()
+{
+	xformStack.insert(xformStack.end(), xform, xform+6);
+	beginOp(OP_SAVE);
+	endOp();
+}
+
+void ofxNanoVGTrace::restore()
+{
+	if (xformStack.size() >= 6) {
+		memcpy(xform, &xformStack[xformStack.size()-6], sizeof(xform));
+		xformStack.resize(xformStack.size()-6);
+	}
+	beginOp(OP_RESTORE);
+	endOp();
+}
+
+void ofxNanoVGTrace::syncTransform(const float *t)
+{
+	if (memcmp(t, xform, sizeof(xform)) == 0) {
+		return;
+	}
+
+	memcpy(xform, t, sizeof(xform));
+	beginOp(OP_TRANSFORM);
+	putBytes(xform, sizeof(xform));
+	endOp();
+}
+
+void ofxNanoVGTrace::scissor(float x, float y, float w, float h)
+{
+	beginOp(OP_SCISSOR);
+	putFloats(x, y, w, h);
+	endOp();
+}
+
+void ofxNanoVGTrace::intersectScissor(float x, float y, float w, float h)
+{
+	beginOp(OP_INTERSECT_SCISSOR);
+	putFloats(x, y, w, h);
+	endOp();
+}
+
+void ofxNanoVGTrace::resetScissor()
+{
+	beginOp(OP_RESET_SCISSOR);
+	endOp();
+}
+
+void ofxNanoVGTrace::beginPath()
+{
+	beginOp(OP_BEGIN_PATH);
+	endOp();
+}
+
+void ofxNanoVGTrace::moveTo(float x, float y)
+{
+	beginOp(OP_MOVE_TO);
+	putFloats(x, y);
+	endOp();
+}
+
+void ofxNanoVGTrace::lineTo(float x, float y)
+{
+	beginOp(OP_LINE_TO);
+	putFloats(x, y);
+	endOp();
+}
+
+void ofxNanoVGTrace::bezierTo(float cx1, float cy1, float cx2, float cy2, float x, float y)
+{
+	beginOp(OP_BEZIER_TO);
+	putFloats(cx1, cy1, cx2, cy2);
+	putFloats(x, y);
+	endOp();
+}
+
+void ofxNanoVGTrace::rect(float x, float y, float w, float h)
+{
+	beginOp(OP_RECT);
+	putFloats(x, y, w, h);
+	endOp();
+}
+
+void ofxNanoVGTrace::roundedRect(float x, float y, float w, float h, float r_tl, float r_tr, float r_br, float r_bl)
+{
+	beginOp(OP_ROUNDED_RECT);
+	putFloats(x, y, w, h);
+	putFloats(r_tl, r_tr, r_br, r_bl);
+	endOp();
+}
+
+void ofxNanoVGTrace::ellipse(float cx, float cy, float rx, float ry)
+{
+	beginOp(OP_ELLIPSE);
+	putFloats(cx, cy, rx, ry);
+	endOp();
+}
+
+void ofxNanoVGTrace::arc(float cx, float cy, float r, float a0, float a1, int dir)
+{
+	beginOp(OP_ARC);
+	putFloats(cx, cy, r, a0);
+	put(a1);
+	put((int32_t)dir);
+	endOp();
+}
+
+void ofxNanoVGTrace::pathWinding(int dir)
+{
+	beginOp(OP_PATH_WINDING);
+	put((int32_t)dir);
+	endOp();
+}
+
+void ofxNanoVGTrace::fill()
+{
+	beginOp(OP_FILL);
+	endOp();
+}
+
+void ofxNanoVGTrace::stroke()
+{
+	beginOp(OP_STROKE);
+	endOp();
+}
+
+void ofxNanoVGTrace::strokeWidth(float width)
+{
+	beginOp(OP_STROKE_WIDTH);
+	put(width);
+	endOp();
+}
+
+void ofxNanoVGTrace::lineCap(int cap)
+{
+	beginOp(OP_LINE_CAP);
+	put((int32_t)cap);
+	endOp();
+}
+
+void ofxNanoVGTrace::lineJoin(int join)
+{
+	beginOp(OP_LINE_JOIN);
+	put((int32_t)join);
+	endOp();
+}
+
+void ofxNanoVGTrace::fillColor(const NVGcolor &c)
+{
+	beginOp(OP_FILL_COLOR);
+	putBytes(c.rgba, sizeof(float)*4);
+	endOp();
+}
+
+void ofxNanoVGTrace::strokeColor(const NVGcolor &c)
+{
+	beginOp(OP_STROKE_COLOR);
+	putBytes(c.rgba, sizeof(float)*4);
+	endOp();
+}
+
+void ofxNanoVGTrace::fillPaint(const NVGpaint &paint)
+{
+	beginOp(OP_FILL_PAINT);
+	putPaint(paint);
+	endOp();
+}
+
+void ofxNanoVGTrace::strokePaint(const NVGpaint &paint)
+{
+	beginOp(OP_STROKE_PAINT);
+	putPaint(paint);
+	endOp();
+}
+
+void ofxNanoVGTrace::font(int id, const string &name, const unsigned char *data, int size)
+{
+	fonts.insert(id);
+	beginOp(OP_FONT);
+	put((int32_t)id);
+	put((uint32_t)name.size());
+	putBytes(name.c_str(), name.size());
+	put((uint32_t)size);
+	putBytes(data, size);
+	endOp();
+}
+
+void ofxNanoVGTrace::image(int id, int w, int h, int flags, const unsigned char *rgba)
+{
+	images.insert(id);
+	beginOp(OP_IMAGE);
+	put((int32_t)id);
+	put((int32_t)w);
+	put((int32_t)h);
+	put((int32_t)flags);
+	put((uint8_t)(rgba != NULL));
+	if (rgba != NULL) {
+		putBytes(rgba, w*h*4);
+	}
+	endOp();
+}
+
+void ofxNanoVGTrace::deleteImage(int id)
+{
+	images.erase(id);
+	beginOp(OP_DELETE_IMAGE);
+	put((int32_t)id);
+	endOp();
+}
+
+void ofxNanoVGTrace::fontFace(int id)
+{
+	beginOp(OP_FONT_FACE);
+	put((int32_t)id);
+	endOp();
+}
+
+void ofxNanoVGTrace::fontSize(float size)
+{
+	beginOp(OP_FONT_SIZE);
+	put(size);
+	endOp();
+}
+
+void ofxNanoVGTrace::letterSpacing(float spacing)
+{
+	beginOp(OP_LETTER_SPACING);
+	put(spacing);
+	endOp();
+}
+
+void ofxNanoVGTrace::lineHeight(float height)
+{
+	beginOp(OP_LINE_HEIGHT);
+	put(height);
+	endOp();
+}
+
+void ofxNanoVGTrace::textAlign(int align)
+{
+	beginOp(OP_TEXT_ALIGN);
+	put((int32_t)align);
+	endOp();
+}
+
+void ofxNanoVGTrace::fontBlur(float blur)
+{
+	beginOp(OP_FONT_BLUR);
+	put(blur);
+	endOp();
+}
+
+void ofxNanoVGTrace::text(float x, float y, const char *str, const char *end)
+{
+	if (end == NULL) {
+		end = str + strlen(str);
+	}
+	beginOp(OP_TEXT);
+	putFloats(x, y);
+	putBytes(str, end-str);
+	endOp();
+}
+
+void ofxNanoVGTrace::textBox(float x, float y, float breakRowWidth, const char *str, const char *end)
+{
+	if (end == NULL) {
+		end = str + strlen(str);
+	}
+	beginOp(OP_TEXT_BOX);
+	putFloats(x, y);
+	put(breakRowWidth);
+	putBytes(str, end-str);
+	endOp();
+}
+
+void ofxNanoVGTrace::directStroke(const NVGpaint &paint, const NVGscissor &scissor, float fringe, float strokeWidth, bool closed, const NVGvertex *verts, int nverts)
+{
+	beginOp(OP_DIRECT_STROKE);
+	putPaint(paint);
+	putBytes(scissor.xform, sizeof(float)*6);
+	putBytes(scissor.extent, sizeof(float)*2);
+	putFloats(fringe, strokeWidth);
+	put((uint8_t)closed);
+	putBytes(verts, nverts*VERTEX_SIZE);
+	endOp();
+}
+
+void ofxNanoVGTrace::directTriangles(const NVGpaint &paint, const NVGscissor &scissor, const NVGvertex *verts, int nverts)
+{
+	beginOp(OP_DIRECT_TRIANGLES);
+	putPaint(paint);
+	putBytes(scissor.xform, sizeof(float)*6);
+	putBytes(scissor.extent, sizeof(float)*2);
+	putBytes(verts, nverts*VERTEX_SIZE);
+	endOp();
+}
+
+/*******************************************************************************
+ * Replay
+ ******************************************************************************/
+
+template<typename T> static T get(const unsigned char*& p)
+{
+	T value;
+	memcpy(&value, p, sizeof(T));
+	p += sizeof(T);
+	return value;
+}
+
+static void getFloats(const unsigned char*& p, float* dst, int count)
+{
+	memcpy(dst, p, count*sizeof(float));
+	p += count*sizeof(float);
+}
+
+static NVGpaint getPaint(const unsigned char*& p, const map<int, int>& imageIds)
+{
+	NVGpaint paint;
+	getFloats(p, paint.xform, 6);
+	getFloats(p, paint.extent, 2);
+	paint.radius = get<float>(p);
+	paint.feather = get<float>(p);
+	getFloats(p, paint.innerColor.rgba, 4);
+	getFloats(p, paint.outerColor.rgba, 4);
+	int image = get<int32_t>(p);
+	map<int, int>::const_iterator it = imageIds.find(image);
+	paint.image = it != imageIds.end() ? it->second : 0;
+	return paint;
+}
+
+// payload bytes every record of op carries at least
+static uint32_t getMinSize(int op)
+{
+	switch (op) {
+		case ofxNanoVGTrace::OP_BEGIN_FRAME: return 13;
+		case ofxNanoVGTrace::OP_END_FRAME: return 0;
+		case ofxNanoVGTrace::OP_TRANSFORM: return 24;
+		case ofxNanoVGTrace::OP_SCISSOR:
+		case ofxNanoVGTrace::OP_INTERSECT_SCISSOR:
+		case ofxNanoVGTrace::OP_RECT:
+		case ofxNanoVGTrace::OP_ELLIPSE:
+		case ofxNanoVGTrace::OP_FILL_COLOR:
+		case ofxNanoVGTrace::OP_STROKE_COLOR: return 16;
+		case ofxNanoVGTrace::OP_MOVE_TO:
+		case ofxNanoVGTrace::OP_LINE_TO:
+		case ofxNanoVGTrace::OP_TEXT: return 8;
+		case ofxNanoVGTrace::OP_BEZIER_TO:
+		case ofxNanoVGTrace::OP_ARC: return 24;
+		case ofxNanoVGTrace::OP_ROUNDED_RECT: return 32;
+		case ofxNanoVGTrace::OP_STROKE_WIDTH:
+		case ofxNanoVGTrace::OP_LINE_CAP:
+		case ofxNanoVGTrace::OP_LINE_JOIN:
+		case ofxNanoVGTrace::OP_DELETE_IMAGE:
+		case ofxNanoVGTrace::OP_FONT_FACE:
+		case ofxNanoVGTrace::OP_FONT_SIZE:
+		case ofxNanoVGTrace::OP_LETTER_SPACING:
+		case ofxNanoVGTrace::OP_LINE_HEIGHT:
+		case ofxNanoVGTrace::OP_TEXT_ALIGN:
+		case ofxNanoVGTrace::OP_FONT_BLUR:
+		case ofxNanoVGTrace::OP_PATH_WINDING: return 4;
+		case ofxNanoVGTrace::OP_FILL_PAINT:
+		case ofxNanoVGTrace::OP_STROKE_PAINT: return PAINT_SIZE;
+		case ofxNanoVGTrace::OP_FONT: return 12;
+		case ofxNanoVGTrace::OP_IMAGE: return 17;
+		case ofxNanoVGTrace::OP_TEXT_BOX: return 12;
+		case ofxNanoVGTrace::OP_DIRECT_STROKE: return PAINT_SIZE + SCISSOR_SIZE + 9;
+		case ofxNanoVGTrace::OP_DIRECT_TRIANGLES: return PAINT_SIZE + SCISSOR_SIZE;
+		default: return 0;
+	}
+}
+
+bool ofxNanoVGTracePlayer::readRecord(size_t &pos, int &op, const unsigned char *&payload, uint32_t &size) const
+{
+	const unsigned char* bytes = (const unsigned char*)data.getData();
+	if (pos + 5 > data.size()) {
+		return false;
+	}
+
+	op = bytes[pos];
+	memcpy(&size, bytes + pos + 1, sizeof(size));
+	if (op <= 0 || op >= ofxNanoVGTrace::OP_COUNT || size < getMinSize(op) || size > data.size() - pos - 5) {
+		return false;
+	}
+
+	payload = bytes + pos + 5;
+	pos += 5 + size;
+	return true;
+}
+
+bool ofxNanoVGTracePlayer::load(const string &filename)
+{
+	bValid = false;
+	frames.clear();
+	fontOffsets.clear();
+	calls.clear();
+	frameTimes.clear();
+	replayCtx = NULL;
+	fontIds.clear();
+	imageIds.clear();
+
+	data = ofBufferFromFile(filename, true);
+	const unsigned char* bytes = (const unsigned char*)data.getData();
+	uint32_t magic = 0, version = 0;
+	if (data.size() >= 8) {
+		memcpy(&magic, bytes, 4);
+		memcpy(&version, bytes + 4, 4);
+	}
+	if (magic != ofxNanoVGTrace::MAGIC || version != ofxNanoVGTrace::VERSION) {
+		ofLogError("ofxNanoVGTracePlayer::load", "not a trace file (or from another version): %s", filename.c_str());
+		return false;
+	}
+
+	// index the top level frames. flush, pushFrame and popFrame split a frame
+	// into several begin/end segments, the ones after the first are marked
+	// nested. A frame cut short (e.g. by a crash) is dropped.
+	size_t pos = 8;
+	Frame frame;
+	bool bFrame = false;	// a top level frame has begun
+	bool bSegment = false;	// inside one of its segments
+	while (pos < data.size()) {
+		size_t start = pos;
+		int op;
+		const unsigned char* payload;
+		uint32_t size;
+		if (!readRecord(pos, op, payload, size)) {
+			ofLogWarning("ofxNanoVGTracePlayer::load", "trace is truncated or corrupt at byte %d", (int)start);
+			break;
+		}
+
+		if (op == ofxNanoVGTrace::OP_FONT) {
+			fontOffsets.push_back(start);
+		}
+		else if (op == ofxNanoVGTrace::OP_BEGIN_FRAME) {
+			// payload: width, height, ratio, nested
+			bool nested = size > 12 && payload[12] != 0;
+			if (!nested) {
+				if (bFrame && !bSegment) {
+					frames.push_back(frame);
+				}
+				frame.begin = start;
+				bFrame = true;
+			}
+			bSegment = true;
+		}
+		else if (op == ofxNanoVGTrace::OP_END_FRAME && bSegment) {
+			frame.end = pos;
+			bSegment = false;
+		}
+	}
+	if (bFrame && !bSegment) {
+		frames.push_back(frame);
+	}
+
+	bValid = true;
+	return true;
+}
+
+void ofxNanoVGTracePlayer::defineFonts(NVGcontext *ctx)
+{
+	for (size_t offset : fontOffsets) {
+		size_t pos = offset;
+		int op;
+		const unsigned char* p;
+		uint32_t size;
+		readRecord(pos, op, p, size);
+
+		const unsigned char* end = p + size;
+		int id = get<int32_t>(p);
+		uint32_t nameSize = get<uint32_t>(p);
+		if (nameSize > (uint32_t)(end - p) - 4) {
+			continue;
+		}
+		string name((const char*)p, nameSize);
+		p += nameSize;
+		uint32_t fontSize = get<uint32_t>(p);
+		if (fontSize > (uint32_t)(end - p)) {
+			continue;
+		}
+
+		// nanovg frees the copy with the context
+		unsigned char* copy = (unsigned char*)malloc(fontSize);
+		memcpy(copy, p, fontSize);
+		int replayId = nvgCreateFontMem(ctx, name.c_str(), copy, fontSize, 1);
+		if (replayId < 0) {
+			ofLogError("ofxNanoVGTracePlayer", "could not create traced font %s", name.c_str());
+			continue;
+		}
+		fontIds[id] = replayId;
+	}
+}
+
+void ofxNanoVGTracePlayer::replay(NVGcontext *ctx, int frame)
+{
+	if (!bValid || ctx == NULL) {
+		return;
+	}
+
+	if (frame >= (int)frames.size()) {
+		ofLogError("ofxNanoVGTracePlayer::replay", "no frame %d in the trace", frame);
+		return;
+	}
+
+	if (ctx != replayCtx) {
+		replayCtx = ctx;
+		fontIds.clear();
+		defineFonts(ctx);
+	}
+
+	calls.clear();
+	frameTimes.assign(frames.size(), 0);
+	int first = frame < 0 ? 0 : frame;
+	int last = frame < 0 ? frames.size()-1 : frame;
+	for (int f=first; f<=last; f++) {
+		size_t pos = frames[f].begin;
+		while (pos < frames[f].end) {
+			Call call;
+			call.frame = f;
+			call.offset = pos;
+			const unsigned char* payload;
+			uint32_t size;
+			readRecord(pos, call.op, payload, size);
+			if (call.op == ofxNanoVGTrace::OP_FONT) {
+				continue;
+			}
+
+			auto start = std::chrono::high_resolution_clock::now();
+			execute(ctx, call.op, payload, size);
+			auto end = std::chrono::high_resolution_clock::now();
+			call.micros = std::chrono::duration<float, std::micro>(end - start).count();
+			frameTimes[f] += call.micros;
+			calls.push_back(call);
+		}
+
+		// images the wrapper didn't delete itself (external textures)
+		for (auto& image : imageIds) {
+			nvgDeleteImage(ctx, image.second);
+		}
+		imageIds.clear();
+		for (int image : releasedImages) {
+			nvgDeleteImage(ctx, image);
+		}
+		releasedImages.clear();
+	}
+}
+
+void ofxNanoVGTracePlayer::execute(NVGcontext *ctx, int op, const unsigned char *p, uint32_t size)
+{
+	const unsigned char* end = p + size;
+	float f[8];
+
+	switch (op) {
+		case ofxNanoVGTrace::OP_BEGIN_FRAME: {
+			int w = get<int32_t>(p);
+			int h = get<int32_t>(p);
+			float ratio = get<float>(p);
+			nvgBeginFrame(ctx, w, h, ratio);
+			break;
+		}
+		case ofxNanoVGTrace::OP_END_FRAME:
+			nvgEndFrame(ctx);
+			for (int image : releasedImages) {
+				nvgDeleteImage(ctx, image);
+			}
+			releasedImages.clear();
+			break;
+		case ofxNanoVGTrace::OP_SAVE:
+			nvgSave(ctx);
+			break;
+		case ofxNanoVGTrace::OP_RESTORE:
+			nvgRestore(ctx);
+			break;
+		case ofxNanoVGTrace::OP_TRANSFORM:
+			getFloats(p, f, 6);
+			nvgResetTransform(ctx);
+			nvgTransform(ctx, f[0], f[1], f[2], f[3], f[4], f[5]);
+			break;
+		case ofxNanoVGTrace::OP_SCISSOR:
+			getFloats(p, f, 4);
+			nvgScissor(ctx, f[0], f[1], f[2], f[3]);
+			break;
+		case ofxNanoVGTrace::OP_INTERSECT_SCISSOR:
+			getFloats(p, f, 4);
+			nvgIntersectScissor(ctx, f[0], f[1], f[2], f[3]);
+			break;
+		case ofxNanoVGTrace::OP_RESET_SCISSOR:
+			nvgResetScissor(ctx);
+			break;
+		case ofxNanoVGTrace::OP_BEGIN_PATH:
+			nvgBeginPath(ctx);
+			break;
+		case ofxNanoVGTrace::OP_MOVE_TO:
+			getFloats(p, f, 2);
+			nvgMoveTo(ctx, f[0], f[1]);
+			break;
+		case ofxNanoVGTrace::OP_LINE_TO:
+			getFloats(p, f, 2);
+			nvgLineTo(ctx, f[0], f[1]);
+			break;
+		case ofxNanoVGTrace::OP_BEZIER_TO:
+			getFloats(p, f, 6);
+			nvgBezierTo(ctx, f[0], f[1], f[2], f[3], f[4], f[5]);
+			break;
+		case ofxNanoVGTrace::OP_RECT:
+			getFloats(p, f, 4);
+			nvgRect(ctx, f[0], f[1], f[2], f[3]);
+			break;
+		case ofxNanoVGTrace::OP_ROUNDED_RECT:
+			getFloats(p, f, 8);
+			nvgRoundedRect4(ctx, f[0], f[1], f[2], f[3], f[4], f[5], f[6], f[7]);
+			break;
+		case ofxNanoVGTrace::OP_ELLIPSE:
+			getFloats(p, f, 4);
+			nvgEllipse(ctx, f[0], f[1], f[2], f[3]);
+			break;
+		case ofxNanoVGTrace::OP_ARC: {
+			getFloats(p, f, 5);
+			int dir = get<int32_t>(p);
+			nvgArc(ctx, f[0], f[1], f[2], f[3], f[4], dir);
+			break;
+		}
+		case ofxNanoVGTrace::OP_PATH_WINDING:
+			nvgPathWinding(ctx, get<int32_t>(p));
+			break;
+		case ofxNanoVGTrace::OP_FILL:
+			nvgFill(ctx);
+			break;
+		case ofxNanoVGTrace::OP_STROKE:
+			nvgStroke(ctx);
+			break;
+		case ofxNanoVGTrace::OP_STROKE_WIDTH:
+			nvgStrokeWidth(ctx, get<float>(p));
+			break;
+		case ofxNanoVGTrace::OP_LINE_CAP:
+			nvgLineCap(ctx, get<int32_t>(p));
+			break;
+		case ofxNanoVGTrace::OP_LINE_JOIN:
+			nvgLineJoin(ctx, get<int32_t>(p));
+			break;
+		case ofxNanoVGTrace::OP_FILL_COLOR:
+			getFloats(p, f, 4);
+			nvgFillColor(ctx, nvgRGBAf(f[0], f[1], f[2], f[3]));
+			break;
+		case ofxNanoVGTrace::OP_STROKE_COLOR:
+			getFloats(p, f, 4);
+			nvgStrokeColor(ctx, nvgRGBAf(f[0], f[1], f[2], f[3]));
+			break;
+		case ofxNanoVGTrace::OP_FILL_PAINT:
+			nvgFillPaint(ctx, getPaint(p, imageIds));
+			break;
+		case ofxNanoVGTrace::OP_STROKE_PAINT:
+			nvgStrokePaint(ctx, getPaint(p, imageIds));
+			break;
+		case ofxNanoVGTrace::OP_IMAGE: {
+			int id = get<int32_t>(p);
+			int w = get<int32_t>(p);
+			int h = get<int32_t>(p);
+			int flags = get<int32_t>(p);
+			bool hasData = get<uint8_t>(p);
+			if (w <= 0 || h <= 0 || (hasData && (size_t)(end - p) < (size_t)w*h*4)) {
+				break;
+			}
+			int image;
+			if (hasData) {
+				image = nvgCreateImageRGBA(ctx, w, h, flags, p);
+			}
+			else {
+				vector<unsigned char> white(w*h*4, 255);
+				image = nvgCreateImageRGBA(ctx, w, h, flags, &white[0]);
+			}
+			if (image > 0) {
+				// new content for the id
+				auto it = imageIds.find(id);
+				if (it != imageIds.end()) {
+					releasedImages.push_back(it->second);
+				}
+				imageIds[id] = image;
+			}
+			break;
+		}
+		case ofxNanoVGTrace::OP_DELETE_IMAGE: {
+			auto it = imageIds.find(get<int32_t>(p));
+			if (it != imageIds.end()) {
+				releasedImages.push_back(it->second);
+				imageIds.erase(it);
+			}
+			break;
+		}
+		case ofxNanoVGTrace::OP_FONT_FACE: {
+			auto it = fontIds.find(get<int32_t>(p));
+			if (it != fontIds.end()) {
+				nvgFontFaceId(ctx, it->second);
+			}
+			break;
+		}
+		case ofxNanoVGTrace::OP_FONT_SIZE:
+			nvgFontSize(ctx, get<float>(p));
+			break;
+		case ofxNanoVGTrace::OP_LETTER_SPACING:
+			nvgTextLetterSpacing(ctx, get<float>(p));
+			break;
+		case ofxNanoVGTrace::OP_LINE_HEIGHT:
+			nvgTextLineHeight(ctx, get<float>(p));
+			break;
+		case ofxNanoVGTrace::OP_TEXT_ALIGN:
+			nvgTextAlign(ctx, get<int32_t>(p));
+			break;
+		case ofxNanoVGTrace::OP_FONT_BLUR:
+			nvgFontBlur(ctx, get<float>(p));
+			break;
+		case ofxNanoVGTrace::OP_TEXT:
+			getFloats(p, f, 2);
+			nvgText(ctx, f[0], f[1], (const char*)p, (const char*)end);
+			break;
+		case ofxNanoVGTrace::OP_TEXT_BOX:
+			getFloats(p, f, 3);
+			nvgTextBox(ctx, f[0], f[1], f[2], (const char*)p, (const char*)end);
+			break;
+		case ofxNanoVGTrace::OP_DIRECT_STROKE:
+		case ofxNanoVGTrace::OP_DIRECT_TRIANGLES: {
+			NVGpaint paint = getPaint(p, imageIds);
+			NVGscissor scissor;
+			getFloats(p, scissor.xform, 6);
+			getFloats(p, scissor.extent, 2);
+			NVGparams* params = nvgInternalParams(ctx);
+			if (op == ofxNanoVGTrace::OP_DIRECT_TRIANGLES) {
+				vector<NVGvertex> verts((end - p) / VERTEX_SIZE);
+				if (!verts.empty()) {
+					memcpy(&verts[0], p, verts.size()*VERTEX_SIZE);
+					params->renderTriangles(params->userPtr, &paint, &scissor, &verts[0], verts.size());
+				}
+				break;
+			}
+			getFloats(p, f, 2);
+			bool closed = get<uint8_t>(p);
+			vector<NVGvertex> verts((end - p) / VERTEX_SIZE);
+			if (!verts.empty()) {
+				memcpy(&verts[0], p, verts.size()*VERTEX_SIZE);
+				NVGpath path;
+				memset(&path, 0, sizeof(path));
+				path.closed = closed;
+				path.stroke = &verts[0];
+				path.nstroke = verts.size();
+				params->renderStroke(params->userPtr, &paint, &scissor, f[0], f[1], &path, 1);
+			}
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+float ofxNanoVGTracePlayer::getFrameTime(int frame) const
+{
+	if (frame < 0 || frame >= (int)frameTimes.size()) {
+		return 0;
+	}
+	return frameTimes[frame];
+}
+
+vector<ofxNanoVGTracePlayer::Call> ofxNanoVGTracePlayer::getSlowestCalls(int count) const
+{
+	vector<Call> slowest = calls;
+	count = min(count, (int)slowest.size());
+	std::partial_sort(slowest.begin(), slowest.begin()+count, slowest.end(), [](const Call& a, const Call& b) {
+		return a.micros > b.micros;
+	});
+	slowest.resize(count);
+	return slowest;
+}
+
+void ofxNanoVGTracePlayer::logTimings(int count) const
+{
+	vector<float> total(ofxNanoVGTrace::OP_COUNT, 0);
+	vector<int> num(ofxNanoVGTrace::OP_COUNT, 0);
+	for (const Call& call : calls) {
+		total[call.op] += call.micros;
+		num[call.op]++;
+	}
+
+	vector<int> ops;
+	for (int op=1; op<ofxNanoVGTrace::OP_COUNT; op++) {
+		if (num[op] > 0) {
+			ops.push_back(op);
+		}
+	}
+	std::sort(ops.begin(), ops.end(), [&](int a, int b) { return total[a] > total[b]; });
+
+	ofLogNotice("ofxNanoVGTracePlayer") << "time per call type (us):";
+	for (int op : ops) {
+		ofLogNotice("ofxNanoVGTracePlayer", "%18s %8d calls %12.1f total %8.2f avg", ofxNanoVGTrace::getOpName(op), num[op], total[op], total[op]/num[op]);
+	}
+
+	ofLogNotice("ofxNanoVGTracePlayer") << "slowest calls (us):";
+	for (const Call& call : getSlowestCalls(count)) {
+		ofLogNotice("ofxNanoVGTracePlayer", "frame %4d  %18s at byte %10d %10.1f", call.frame, ofxNanoVGTrace::getOpName(call.op), (int)call.offset, call.micros);
+	}
+}
+
+/*******************************************************************************
+ * Headless backend
+ ******************************************************************************/
+
+struct HeadlessBackend {
+	vector<std::pair<int, int> > textures;
+};
+
+static int headlessCreate(void* uptr) { return 1; }
+static int headlessCreateTexture(void* uptr, int type, int w, int h, int imageFlags, const unsigned char* data)
+{
+	HeadlessBackend* backend = (HeadlessBackend*)uptr;
+	backend->textures.push_back(std::make_pair(w, h));
+	return backend->textures.size();
+}
+static int headlessDeleteTexture(void* uptr, int image) { return 1; }
+static int headlessUpdateTexture(void* uptr, int image, int x, int y, int w, int h, const unsigned char* data) { return 1; }
+static int headlessGetTextureSize(void* uptr, int image, int* w, int* h)
+{
+	HeadlessBackend* backend = (HeadlessBackend*)uptr;
+	if (image <= 0 || image > (int)backend->textures.size()) {
+		return 0;
+	}
+	*w = backend->textures[image-1].first;
+	*h = backend->textures[image-1].second;
+	return 1;
+}
+static void headlessViewport(void* uptr, int width, int height) {}
+static void headlessCancel(void* uptr) {}
+static void headlessFlush(void* uptr) {}
+static void headlessFill(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, const float* bounds, const NVGpath* paths, int npaths) {}
+static void headlessStroke(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths) {}
+static void headlessTriangles(void* uptr, NVGpaint* paint, NVGscissor* scissor, const NVGvertex* verts, int nverts) {}
+static void headlessDelete(void* uptr) { delete (HeadlessBackend*)uptr; }
+
+NVGcontext* ofxNanoVGTracePlayer::createHeadlessContext()
+{
+	NVGparams params;
+	memset(&params, 0, sizeof(params));
+	params.userPtr = new HeadlessBackend();
+	params.edgeAntiAlias = 1;
+	params.renderCreate = headlessCreate;
+	params.renderCreateTexture = headlessCreateTexture;
+	params.renderDeleteTexture = headlessDeleteTexture;
+	params.renderUpdateTexture = headlessUpdateTexture;
+	params.renderGetTextureSize = headlessGetTextureSize;
+	params.renderViewport = headlessViewport;
+	params.renderCancel = headlessCancel;
+	params.renderFlush = headlessFlush;
+	params.renderFill = headlessFill;
+	params.renderStroke = headlessStroke;
+	params.renderTriangles = headlessTriangles;
+	params.renderDelete = headlessDelete;
+
+	// on failure nvgCreateInternal deletes the backend through renderDelete
+	return nvgCreateInternal(&params);
+}
+
+void ofxNanoVGTracePlayer::deleteHeadlessContext(NVGcontext *ctx)
+{
+	if (ctx != NULL) {
+		nvgDeleteInternal(ctx);
+	}
+}
@@ -0,0 +1,214 @@
+//
+//  ofxNanoVGTrace.h
+//  ofxNanoVG
+//
+//  Binary trace of the calls ofxNanoVG makes into NanoVG between beginFrame
+//  and endFrame, and a player that re-executes a trace against any NanoVG
+//  context with per-call timing.
+//
+//  A trace is a header followed by records of [op:u8][size:u32][payload].
+//  Path commands are recorded in local coordinates with the transform they
+//  were issued under, the way NanoVG itself consumes them. Fonts are stored
+//  once per trace with their data and images once per frame (pixels for
+//  images the wrapper created, a placeholder of the same size for external
+//  textures), so a trace replays on a machine without the app's assets.
+//
+
+#ifndef __ofxNanoVG__ofxNanoVGTrace__
+#define __ofxNanoVG__ofxNanoVGTrace__
+
+#include "ofMain.h"
+#include "nanovg.h"
+
+class ofxNanoVGTrace
+{
+public:
+	ofxNanoVGTrace();
+	~ofxNanoVGTrace();
+
+	enum Op {
+		OP_BEGIN_FRAME = 1,
+		OP_END_FRAME,
+		OP_SAVE,
+		OP_RESTORE,
+		OP_TRANSFORM,
+		OP_SCISSOR,
+		OP_INTERSECT_SCISSOR,
+		OP_RESET_SCISSOR,
+		OP_BEGIN_PATH,
+		OP_MOVE_TO,
+		OP_LINE_TO,
+		OP_BEZIER_TO,
+		OP_RECT,
+		OP_ROUNDED_RECT,
+		OP_ELLIPSE,
+		OP_ARC,
+		OP_FILL,
+		OP_STROKE,
+		OP_STROKE_WIDTH,
+		OP_LINE_CAP,
+		OP_LINE_JOIN,
+		OP_FILL_COLOR,
+		OP_STROKE_COLOR,
+		OP_FILL_PAINT,
+		OP_STROKE_PAINT,
+		OP_FONT,
+		OP_IMAGE,
+		OP_DELETE_IMAGE,
+		OP_FONT_FACE,
+		OP_FONT_SIZE,
+		OP_LETTER_SPACING,
+		OP_LINE_HEIGHT,
+		OP_TEXT_ALIGN,
+		OP_FONT_BLUR,
+		OP_TEXT,
+		OP_TEXT_BOX,
+		OP_DIRECT_STROKE,
+		OP_DIRECT_TRIANGLES,
+		OP_PATH_WINDING,
+		OP_COUNT
+	};
+	static const char* getOpName(int op);
+
+	static const uint32_t MAGIC = 0x5447564e;	// "NVGT"
+	static const uint32_t VERSION = 1;
+
+	bool open(const string& filename);
+	void close();
+	bool isOpen() const { return file != NULL; }
+	// bytes written to the file so far
+	size_t getSize() const { return written; }
+
+	// nested marks frames opened by flush, pushFrame or popFrame
+	void beginFrame(int width, int height, float devicePixelRatio, bool nested);
+	void endFrame();
+	void save();
+	void restore();
+	// record the transform when it differs from the last one recorded
+	void syncTransform(const float* xform);
+	void scissor(float x, float y, float w, float h);
+	void intersectScissor(float x, float y, float w, float h);
+	void resetScissor();
+
+	void beginPath();
+	void moveTo(float x, float y);
+	void lineTo(float x, float y);
+	void bezierTo(float cx1, float cy1, float cx2, float cy2, float x, float y);
+	void rect(float x, float y, float w, float h);
+	void roundedRect(float x, float y, float w, float h, float r_tl, float r_tr, float r_br, float r_bl);
+	void ellipse(float cx, float cy, float rx, float ry);
+	// angles in radians, as passed to nvgArc
+	void arc(float cx, float cy, float r, float a0, float a1, int dir);
+	void pathWinding(int dir);
+	void fill();
+	void stroke();
+
+	void strokeWidth(float width);
+	void lineCap(int cap);
+	void lineJoin(int join);
+	void fillColor(const NVGcolor& c);
+	void strokeColor(const NVGcolor& c);
+	void fillPaint(const NVGpaint& paint);
+	void strokePaint(const NVGpaint& paint);
+
+	bool hasFont(int id) const { return fonts.count(id) > 0; }
+	void font(int id, const string& name, const unsigned char* data, int size);
+	bool hasImage(int id) const { return images.count(id) > 0; }
+	// rgba is w*h*4 bytes, or NULL for a placeholder
+	void image(int id, int w, int h, int flags, const unsigned char* rgba);
+	void deleteImage(int id);
+
+	void fontFace(int id);
+	void fontSize(float size);
+	void letterSpacing(float spacing);
+	void lineHeight(float height);
+	void textAlign(int align);
+	void fontBlur(float blur);
+	void text(float x, float y, const char* str, const char* end);
+	void textBox(float x, float y, float breakRowWidth, const char* str, const char* end);
+
+	// geometry ofxNanoVG hands straight to the backend, in frame coordinates
+	void directStroke(const NVGpaint& paint, const NVGscissor& scissor, float fringe, float strokeWidth, bool closed, const NVGvertex* verts, int nverts);
+	void directTriangles(const NVGpaint& paint, const NVGscissor& scissor, const NVGvertex* verts, int nverts);
+
+private:
+	void beginOp(Op op);
+	void endOp();
+	void flush();
+	template<typename T> void put(const T& value) {
+		const unsigned char* p = (const unsigned char*)&value;
+		buffer.insert(buffer.end(), p, p + sizeof(T));
+	}
+	void putBytes(const void* data, size_t size);
+	void putPaint(const NVGpaint& paint);
+	void putFloats(float a, float b);
+	void putFloats(float a, float b, float c, float d);
+
+	FILE* file;
+	size_t written;
+	vector<unsigned char> buffer;	// records of the current frame
+	size_t opStart;
+	float xform[6];
+	vector<float> xformStack;
+	std::set<int> fonts;
+	std::set<int> images;
+};
+
+class ofxNanoVGTracePlayer
+{
+public:
+	ofxNanoVGTracePlayer() : bValid(false), replayCtx(NULL) {}
+
+	struct Call {
+		int frame;
+		int op;
+		size_t offset;	// of the record in the trace file
+		float micros;
+	};
+
+	bool load(const string& filename);
+	bool isLoaded() const { return bValid; }
+	// top level frames, nested frames are replayed as part of their parent
+	int getNumFrames() const { return frames.size(); }
+
+	// Re-execute frame (or all frames when -1) into ctx, outside of any frame
+	// of the context. NanoVG defers drawing to nvgEndFrame, so fills, strokes
+	// and text time the tessellation and OP_END_FRAME times the backend.
+	// Images deleted by a frame are recorded before its end and deleted once
+	// nvgEndFrame has drawn it.
+	void replay(NVGcontext* ctx, int frame=-1);
+
+	// calls of the last replay, in trace order
+	const vector<Call>& getCalls() const { return calls; }
+	float getFrameTime(int frame) const;
+	vector<Call> getSlowestCalls(int count) const;
+	// log time per op type and the slowest calls of the last replay
+	void logTimings(int count=20) const;
+
+	// NanoVG context with a backend that does nothing, to time the
+	// tessellation alone or replay where there is no GL context
+	static NVGcontext* createHeadlessContext();
+	static void deleteHeadlessContext(NVGcontext* ctx);
+
+private:
+	bool readRecord(size_t& pos, int& op, const unsigned char*& payload, uint32_t& size) const;
+	void defineFonts(NVGcontext* ctx);
+	void execute(NVGcontext* ctx, int op, const unsigned char* payload, uint32_t size);
+
+	ofBuffer data;
+	bool bValid;
+	struct Frame {
+		size_t begin;	// offsets of the first and past the last record
+		size_t end;
+	};
+	vector<Frame> frames;
+	vector<size_t> fontOffsets;
+	vector<float> frameTimes;
+	vector<Call> calls;
+	NVGcontext* replayCtx;
+	map<int, int> fontIds;		// traced id -> id in replayCtx
+	map<int, int> imageIds;
+	vector<int> releasedImages;	// deleted at the next OP_END_FRAME
+};
+
+#endif /* defined(__ofxNanoVG__ofxNanoVGTrace__) */
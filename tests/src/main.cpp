@@ -0,0 +1,79 @@
+//
+//  main.cpp
+//  ofxNanoVG tests
+//
+
+#include "ofMain.h"
+#include "ofxNanoVG.h"
+#include "ofxNanoVGTest.h"
+
+struct Test {
+	const char* name;
+	ofxNanoVGTest::Function function;
+};
+
+static vector<Test>& getTests()
+{
+	static vector<Test> tests;
+	return tests;
+}
+
+static int failures = 0;
+
+bool ofxNanoVGTest::add(const char *name, Function function)
+{
+	Test test = { name, function };
+	getTests().push_back(test);
+	return true;
+}
+
+void ofxNanoVGTest::fail(const char *file, int line, const string &what)
+{
+	ofLogError("test") << ofFilePath::getFileName(file) << ":" << line << ": " << what;
+	failures++;
+}
+
+int ofxNanoVGTest::run()
+{
+	for (const Test& test : getTests()) {
+		int before = failures;
+		test.function();
+		ofLogNotice("test") << test.name << (failures == before ? ": ok" : ": FAILED");
+	}
+	ofLogNotice("test") << getTests().size() << " tests, " << failures << " failed checks";
+	return failures;
+}
+
+string ofxNanoVGTest::findFont()
+{
+	if (ofFile::doesFileExist("font.ttf")) {
+		return "font.ttf";
+	}
+#ifdef TARGET_LINUX
+	string path = ofTrim(ofSystem("fc-match -f '%{file}' sans"));
+	if (!path.empty() && ofFile::doesFileExist(path, false)) {
+		return path;
+	}
+#endif
+	return "";
+}
+
+class ofApp : public ofBaseApp
+{
+public:
+	void setup()
+	{
+		ofxNanoVG::one().setup();
+		ofExit(ofxNanoVGTest::run() == 0 ? 0 : 1);
+	}
+};
+
+int main()
+{
+	ofGLWindowSettings settings;
+	settings.setGLVersion(3, 2);
+	settings.width = 640;
+	settings.height = 480;
+	ofCreateWindow(settings);
+	return ofRunApp(new ofApp());
+}
@@ -0,0 +1,48 @@
+//
+//  ofxNanoVGTest.h
+//  ofxNanoVG tests
+//
+//  A minimal harness: TEST(name) registers a test, the CHECK macros report
+//  failed conditions and run() runs every registered test once.
+//
+
+#ifndef __ofxNanoVG__ofxNanoVGTest__
+#define __ofxNanoVG__ofxNanoVGTest__
+
+#include "ofMain.h"
+
+namespace ofxNanoVGTest
+{
+	typedef void (*Function)();
+
+	bool add(const char* name, Function function);
+	void fail(const char* file, int line, const string& what);
+	// returns the number of failed checks
+	int run();
+
+	// bin/data/font.ttf, or the system's sans font on linux; empty if
+	// there is neither and the tests that draw text are skipped
+	string findFont();
+}
+
+#define TEST(name) \
+	static void test_##name(); \
+	static const bool test_##name##_added __attribute__((unused)) = ofxNanoVGTest::add(#name, test_##name); \
+	static void test_##name()
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			ofxNanoVGTest::fail(__FILE__, __LINE__, #condition); \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do { \
+		double a_ = (a), b_ = (b); \
+		if (!(fabs(a_ - b_) <= (tolerance))) { \
+			ofxNanoVGTest::fail(__FILE__, __LINE__, string(#a " == " #b ": ") + ofToString(a_) + " != " + ofToString(b_)); \
+		} \
+	} while (0)
+
+#endif /* defined(__ofxNanoVG__ofxNanoVGTest__) */
@@ -0,0 +1,133 @@
+//
+//  testBake.cpp
+//  ofxNanoVG tests
+//
+//  Which draws are baked, and bake files saved and loaded.
+//
+
+#include "ofxNanoVG.h"
+#include "ofxNanoVGTest.h"
+
+static NVGpaint solidPaint(float r, float g, float b, float a)
+{
+	NVGpaint paint;
+	memset(&paint, 0, sizeof(paint));
+	nvgTransformIdentity(paint.xform);
+	paint.innerColor = paint.outerColor = nvgRGBAf(r, g, b, a);
+	return paint;
+}
+
+// as nvgResetScissor leaves it
+static NVGscissor noScissor()
+{
+	NVGscissor scissor;
+	memset(&scissor, 0, sizeof(scissor));
+	scissor.extent[0] = scissor.extent[1] = -1;
+	return scissor;
+}
+
+static bool sameMesh(const ofMesh& a, const ofMesh& b)
+{
+	if (a.getNumVertices() != b.getNumVertices() || a.getNumColors() != b.getNumColors()) {
+		return false;
+	}
+	for (size_t i=0; i<a.getNumVertices(); i++) {
+		if (a.getVertex(i) != b.getVertex(i) || a.getColor(i) != b.getColor(i)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+TEST(bakeSaveLoad)
+{
+	ofxNanoVGBake bake;
+	NVGpaint paint = solidPaint(1, 0.5f, 0, 0.8f);
+	NVGscissor scissor = noScissor();
+
+	NVGvertex triangle[3] = { { 0, 0, 0.5f, 1 }, { 10, 0, 0.5f, 1 }, { 0, 10, 0.5f, 1 } };
+	bake.addTriangles(paint, scissor, triangle, 3);
+	CHECK(bake.getMesh().getNumVertices() == 3);
+
+	// a convex fill is a fan, its fringe is a strip of two cross-sections
+	// from the edge outwards, split at the end of the coverage ramp
+	NVGvertex fill[4] = { { 20, 20, 0.5f, 1 }, { 40, 20, 0.5f, 1 }, { 40, 40, 0.5f, 1 }, { 20, 40, 0.5f, 1 } };
+	NVGvertex fringe[4] = { { 20, 19.5f, 0.5f, 1 }, { 20, 20.5f, 0, 1 }, { 40, 19.5f, 0.5f, 1 }, { 40, 20.5f, 0, 1 } };
+	NVGpath path;
+	memset(&path, 0, sizeof(path));
+	path.fill = fill;
+	path.nfill = 4;
+	path.stroke = fringe;
+	path.nstroke = 4;
+	path.closed = 1;
+	path.convex = 1;
+	bake.addFill(paint, scissor, 1, &path, 1);
+	CHECK(bake.getMesh().getNumVertices() == 3 + 6 + 6);
+	for (const ofFloatColor& c : bake.getMesh().getColors()) {
+		CHECK(c.r == 1 && c.g == 0.5f && c.b == 0);
+		CHECK(c.a >= 0 && c.a <= 0.8f);
+	}
+	CHECK(bake.getSkippedDraws() == 0);
+
+	// gradients, images and scissored draws are skipped and counted
+	size_t baked = bake.getMesh().getNumVertices();
+	NVGpaint gradient = paint;
+	gradient.outerColor = nvgRGBAf(0, 0, 1, 1);
+	bake.addTriangles(gradient, scissor, triangle, 3);
+	NVGpaint image = paint;
+	image.image = 1;
+	bake.addTriangles(image, scissor, triangle, 3);
+	NVGscissor clipped = scissor;
+	clipped.extent[0] = clipped.extent[1] = 5;
+	bake.addTriangles(paint, clipped, triangle, 3);
+	bake.addFill(paint, clipped, 1, &path, 1);
+	CHECK(bake.getMesh().getNumVertices() == baked);
+	CHECK(bake.getSkippedGradients() == 1);
+	CHECK(bake.getSkippedImages() == 1);
+	CHECK(bake.getSkippedScissored() == 2);
+	CHECK(bake.getSkippedDraws() == 4);
+
+	CHECK(bake.save("bakeTest.nvgb"));
+	ofxNanoVGBake loaded;
+	CHECK(loaded.load("bakeTest.nvgb"));
+	CHECK(sameMesh(loaded.getMesh(), bake.getMesh()));
+
+	// an empty bake saves and loads as well
+	ofxNanoVGBake empty;
+	CHECK(empty.save("bakeTest.nvgb"));
+	CHECK(loaded.load("bakeTest.nvgb"));
+	CHECK(loaded.empty());
+
+	// truncated files and files of another kind are refused
+	CHECK(bake.save("bakeTest.nvgb"));
+	ofBuffer buffer = ofBufferFromFile("bakeTest.nvgb", true);
+	CHECK(ofBufferToFile("bakeTest.nvgb", ofBuffer(buffer.getData(), buffer.size() - 4), true));
+	CHECK(!loaded.load("bakeTest.nvgb"));
+	CHECK(loaded.empty());
+	buffer.getData()[0] ^= 0xff;
+	CHECK(ofBufferToFile("bakeTest.nvgb", buffer, true));
+	CHECK(!loaded.load("bakeTest.nvgb"));
+	ofFile::removeFile("bakeTest.nvgb");
+}
+
+TEST(bakeDraws)
+{
+	ofxNanoVG& nvg = ofxNanoVG::one();
+	ofxNanoVGBake bake;
+	nvg.beginFrame(400, 300, 1);
+	nvg.beginBake(bake);
+	CHECK(nvg.isBaking());
+	nvg.fillRect(10, 10, 50, 50, ofColor(255, 0, 0));
+	nvg.enableScissor(0, 0, 20, 20);
+	nvg.fillRect(10, 10, 50, 50, ofColor(0, 255, 0));
+	nvg.disableScissor();
+	nvg.endBake();
+	nvg.endFrame();
+
+	CHECK(!nvg.isBaking());
+	CHECK(!bake.empty());
+	CHECK(bake.getSkippedScissored() == 1);
+	for (const ofFloatColor& c : bake.getMesh().getColors()) {
+		CHECK(c.r == 1 && c.g == 0);
+	}
+}
@@ -0,0 +1,73 @@
+//
+//  testDamage.cpp
+//  ofxNanoVG tests
+//
+//  Merging of damage rectangles into the regions of a partial redraw.
+//
+
+#include "ofxNanoVG.h"
+#include "ofxNanoVGTest.h"
+
+static const vector<ofRectangle>& mergeFrame(ofxNanoVG& nvg)
+{
+	nvg.beginFrame(400, 300, 1);
+	nvg.endFrame();
+	return nvg.getDamageRegions();
+}
+
+static bool covers(const vector<ofRectangle>& regions, const ofRectangle& r)
+{
+	for (const ofRectangle& region : regions) {
+		if (r.getLeft() >= region.getLeft() && r.getRight() <= region.getRight() &&
+			r.getTop() >= region.getTop() && r.getBottom() <= region.getBottom()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+TEST(damageMerging)
+{
+	ofxNanoVG& nvg = ofxNanoVG::one();
+	nvg.setPartialRedraw(true);
+	nvg.setMaxDamageRegions(4);
+	// the first frame is always drawn in full
+	CHECK(mergeFrame(nvg).empty());
+
+	// overlapping rectangles become one pixel aligned region, disjoint ones stay apart
+	nvg.addDamageRect(10.5f, 10.5f, 20, 20);
+	nvg.addDamageRect(20, 20, 20, 20);
+	nvg.addDamageRect(200, 200, 10, 10);
+	const vector<ofRectangle>& regions = mergeFrame(nvg);
+	CHECK(regions.size() == 2);
+	CHECK(covers(regions, ofRectangle(10, 10, 30, 30)));
+	CHECK(covers(regions, ofRectangle(200, 200, 10, 10)));
+	for (const ofRectangle& r : regions) {
+		CHECK(r.x == floorf(r.x) && r.y == floorf(r.y) && r.width == floorf(r.width) && r.height == floorf(r.height));
+	}
+
+	// no more than the maximum, merging the closest ones
+	nvg.setMaxDamageRegions(2);
+	nvg.addDamageRect(0, 0, 10, 10);
+	nvg.addDamageRect(15, 0, 10, 10);
+	nvg.addDamageRect(300, 250, 10, 10);
+	const vector<ofRectangle>& limited = mergeFrame(nvg);
+	CHECK(limited.size() == 2);
+	CHECK(covers(limited, ofRectangle(0, 0, 25, 10)));
+	CHECK(covers(limited, ofRectangle(300, 250, 10, 10)));
+
+	// damage is clipped to the frame
+	nvg.addDamageRect(500, 500, 10, 10);
+	nvg.addDamageRect(395, 100, 10, 10);
+	const vector<ofRectangle>& clipped = mergeFrame(nvg);
+	CHECK(clipped.size() == 1);
+	CHECK(covers(clipped, ofRectangle(395, 100, 5, 10)));
+	CHECK(!clipped.empty() && clipped[0].getRight() <= 400);
+
+	// most of the frame damaged is a full redraw
+	nvg.addDamageRect(0, 0, 390, 290);
+	CHECK(mergeFrame(nvg).empty());
+
+	nvg.setPartialRedraw(false);
+	nvg.setMaxDamageRegions(4);
+}
@@ -0,0 +1,109 @@
+//
+//  testFontLoading.cpp
+//  ofxNanoVG tests
+//
+//  Fonts from memory, and fonts mapped on a worker thread that are
+//  registered on the next beginFrame.
+//
+
+#include "ofxNanoVG.h"
+#include "ofxNanoVGTest.h"
+
+// addFontMem doesn't copy, the bytes must outlive the font
+static ofBuffer fontBytes;
+
+TEST(fontMem)
+{
+	ofxNanoVG& nvg = ofxNanoVG::one();
+
+	// anything without a font header is refused before NanoVG parses it
+	const char text[] = "this is not a font, just some text";
+	CHECK(nvg.addFontMem("fontMemText", (const unsigned char*)text, sizeof(text)) == NULL);
+	const unsigned char truncated[] = { 0, 1, 0, 0, 0, 1 };
+	CHECK(nvg.addFontMem("fontMemTruncated", truncated, sizeof(truncated)) == NULL);
+	CHECK(nvg.addFontMem("fontMemNull", NULL, 0) == NULL);
+	CHECK(nvg.getFont("fontMemText") == NULL);
+
+	string path = ofxNanoVGTest::findFont();
+	if (path.empty()) {
+		ofLogNotice("ofxNanoVGTest") << "fontMem: skipped loading, no font at bin/data/font.ttf";
+		return;
+	}
+
+	fontBytes = ofBufferFromFile(path, true);
+	ofxNanoVG::Font* font = nvg.addFontMem("fontMemTest", (const unsigned char*)fontBytes.getData(), fontBytes.size());
+	CHECK(font != NULL);
+	CHECK(font != NULL && font->isLoaded());
+	CHECK(font != NULL && font->data == (const unsigned char*)fontBytes.getData());
+	CHECK(nvg.getFont("fontMemTest") == font);
+}
+
+// the number of onReady calls and the font they were made with
+static int readyCalls;
+static ofxNanoVG::Font* readyFont;
+
+static void waitForFont(ofxNanoVG& nvg)
+{
+	for (int i=0; i<500 && readyCalls == 0; i++) {
+		nvg.beginFrame(640, 480, 1);
+		nvg.endFrame();
+		if (readyCalls == 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+}
+
+TEST(fontAsync)
+{
+	string path = ofxNanoVGTest::findFont();
+	if (path.empty()) {
+		ofLogNotice("ofxNanoVGTest") << "fontAsync: skipped, no font at bin/data/font.ttf";
+		return;
+	}
+
+	// a copy, so the file isn't mapped already by the other tests
+	CHECK(ofFile::copyFromTo(path, "fontAsyncTest.ttf", true, true));
+	ofxNanoVG& nvg = ofxNanoVG::one();
+	readyCalls = 0;
+	readyFont = NULL;
+	ofxNanoVG::Font* font = nvg.addFontAsync("fontAsyncTest", "fontAsyncTest.ttf", [](ofxNanoVG::Font* f) {
+		readyCalls++;
+		readyFont = f;
+	});
+	CHECK(font != NULL);
+	CHECK(!font->isLoaded());
+
+	// the file is mapped meanwhile, but the font is only registered by beginFrame
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	CHECK(readyCalls == 0);
+	CHECK(!font->isLoaded());
+
+	waitForFont(nvg);
+	CHECK(readyCalls == 1);
+	CHECK(readyFont == font);
+	CHECK(font->isLoaded());
+	CHECK(font->dataSize > 0);
+
+	// onReady is called once
+	nvg.beginFrame(640, 480, 1);
+	nvg.endFrame();
+	CHECK(readyCalls == 1);
+
+	// a file that isn't a font still calls onReady, with the font not loaded
+	ofBuffer text;
+	text.set("not a font either, but long enough for the header check");
+	CHECK(ofBufferToFile("fontAsyncInvalid.ttf", text, true));
+	readyCalls = 0;
+	readyFont = NULL;
+	ofxNanoVG::Font* invalid = nvg.addFontAsync("fontAsyncInvalid", "fontAsyncInvalid.ttf", [](ofxNanoVG::Font* f) {
+		readyCalls++;
+		readyFont = f;
+	});
+	waitForFont(nvg);
+	CHECK(readyCalls == 1);
+	CHECK(readyFont == invalid);
+	CHECK(!invalid->isLoaded());
+
+	ofFile::removeFile("fontAsyncTest.ttf");
+	ofFile::removeFile("fontAsyncInvalid.ttf");
+}
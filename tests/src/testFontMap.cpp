@@ -0,0 +1,79 @@
+//
+//  testFontMap.cpp
+//  ofxNanoVG tests
+//
+//  One mapping per font file, shared by every user and released with the
+//  last one.
+//
+
+#include "ofxNanoVG.h"
+#include "ofxNanoVGTest.h"
+
+// a copy of the test font no other test has mapped, empty to skip
+static string copyFont(const string& name)
+{
+	string path = ofxNanoVGTest::findFont();
+	if (path.empty() || !ofFile::copyFromTo(path, name, true, true)) {
+		ofLogNotice("ofxNanoVGTest") << "font map tests: skipped, no font at bin/data/font.ttf";
+		return "";
+	}
+	return name;
+}
+
+TEST(fontMapSharing)
+{
+	string path = copyFont("fontMapTest.ttf");
+	if (path.empty()) {
+		return;
+	}
+
+	int files = ofxNanoVGFontMap::getStats().files;
+	std::shared_ptr<ofxNanoVGFontMap> a = ofxNanoVGFontMap::open(path);
+	std::shared_ptr<ofxNanoVGFontMap> b = ofxNanoVGFontMap::open(ofToDataPath(path, true));
+	CHECK(a);
+	CHECK(a == b);
+	CHECK(ofxNanoVGFontMap::getStats().files == files + 1);
+
+	ofBuffer bytes = ofBufferFromFile(path, true);
+	CHECK(a && a->size() == bytes.size());
+	CHECK(a && memcmp(a->getData(), bytes.getData(), bytes.size()) == 0);
+
+	// released with the last user, and mapped again after that
+	std::weak_ptr<ofxNanoVGFontMap> weak = a;
+	a.reset();
+	CHECK(!weak.expired());
+	b.reset();
+	CHECK(weak.expired());
+	CHECK(ofxNanoVGFontMap::getStats().files == files);
+
+	a = ofxNanoVGFontMap::open(path);
+	CHECK(a);
+	CHECK(ofxNanoVGFontMap::getStats().files == files + 1);
+	a.reset();
+	ofFile::removeFile(path);
+}
+
+TEST(fontMapFonts)
+{
+	string path = copyFont("fontMapFontsTest.ttf");
+	if (path.empty()) {
+		return;
+	}
+
+	// fonts of the same file share one mapping, adding one again returns it
+	ofxNanoVG& nvg = ofxNanoVG::one();
+	int files = ofxNanoVGFontMap::getStats().files;
+	ofxNanoVG::Font* regular = nvg.addFont("fontMapRegular", path);
+	ofxNanoVG::Font* other = nvg.addFont("fontMapOther", path);
+	CHECK(regular != NULL && other != NULL);
+	if (regular == NULL || other == NULL) {
+		return;
+	}
+	CHECK(regular->mapping == other->mapping);
+	CHECK(regular->data == other->data);
+	CHECK(nvg.addFont("fontMapRegular", path) == regular);
+	CHECK(ofxNanoVGFontMap::getStats().files == files + 1);
+	// only the fonts hold it, the registry keeps a weak reference
+	CHECK(regular->mapping.use_count() == 2);
+	ofFile::removeFile(path);
+}
@@ -0,0 +1,76 @@
+//
+//  testGlyphAtlas.cpp
+//  ofxNanoVG tests
+//
+//  Recycling and giving back glyph pages at the memory budget.
+//
+
+#include "ofxNanoVG.h"
+#include "ofxNanoVGTest.h"
+
+// every glyph is wider and taller than half a page, so each takes a page
+#define PAGE_SIZE 128
+#define FONT_SIZE 120
+
+static ofxNanoVGGlyphAtlas::Stats drawFrame(ofxNanoVG& nvg, ofxNanoVG::Font* font, const string& text)
+{
+	nvg.beginFrame(640, 480, 1);
+	nvg.drawText(font, 0, 200, text, FONT_SIZE);
+	nvg.endFrame();
+	return nvg.getGlyphAtlasStats();
+}
+
+TEST(glyphAtlasEviction)
+{
+	string path = ofxNanoVGTest::findFont();
+	if (path.empty()) {
+		ofLogNotice("ofxNanoVGTest") << "glyphAtlasEviction: skipped, no font at bin/data/font.ttf";
+		return;
+	}
+
+	ofxNanoVG& nvg = ofxNanoVG::one();
+	ofxNanoVG::Font* font = nvg.addFont("glyphAtlasTest", path);
+	CHECK(font != NULL);
+	if (font == NULL) {
+		return;
+	}
+
+	// the CPU copy of a page counts as much as its texture
+	size_t pageBytes = PAGE_SIZE * PAGE_SIZE * 2;
+	nvg.setGlyphAtlas(true, pageBytes*2, PAGE_SIZE);
+
+	ofxNanoVGGlyphAtlas::Stats stats = drawFrame(nvg, font, "M");
+	CHECK(stats.pages == 1);
+	CHECK(stats.glyphs == 1);
+	CHECK(stats.rasterized == 1);
+	CHECK(stats.bytes == pageBytes);
+
+	// a glyph drawn again is neither rasterized nor uploaded
+	stats = drawFrame(nvg, font, "M");
+	CHECK(stats.rasterized == 0);
+	CHECK(stats.uploadBytes == 0);
+
+	stats = drawFrame(nvg, font, "O");
+	CHECK(stats.pages == 2);
+	CHECK(stats.bytes == pageBytes*2);
+	CHECK(stats.evictions == 0);
+
+	// a third page is over the budget, the least recently drawn one is recycled
+	stats = drawFrame(nvg, font, "N");
+	CHECK(stats.pages == 2);
+	CHECK(stats.glyphs == 2);
+	CHECK(stats.evictions == 1);
+	stats = drawFrame(nvg, font, "M");
+	CHECK(stats.rasterized == 1);
+	CHECK(stats.evictions == 2);
+
+	// with both pages drawn from in the frame one is added past the budget,
+	// and given back at endFrame
+	stats = drawFrame(nvg, font, "MNO");
+	CHECK(stats.overBudget == 1);
+	CHECK(stats.evictions == 3);
+	CHECK(stats.pages == 2);
+	CHECK(stats.bytes <= stats.budget);
+
+	nvg.setGlyphAtlas(false);
+}
@@ -0,0 +1,88 @@
+//
+//  testHairline.cpp
+//  ofxNanoVG tests
+//
+//  Sub-pixel strokes drawn through the hairline fast path: one strip with
+//  butt caps and no joins, whatever the line cap and join.
+//
+
+#include "ofxNanoVG.h"
+#include "ofxNanoVGTest.h"
+
+// the backend's renderStroke calls, as the vertices of each path
+static vector<vector<NVGvertex> > strokes;
+static NVGparams backend;
+
+static void captureStroke(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths)
+{
+	for (int i=0; i<npaths; i++) {
+		strokes.push_back(vector<NVGvertex>(paths[i].stroke, paths[i].stroke + paths[i].nstroke));
+	}
+	backend.renderStroke(uptr, paint, scissor, fringe, strokeWidth, paths, npaths);
+}
+
+static void beginCapture(ofxNanoVG& nvg)
+{
+	strokes.clear();
+	NVGparams& params = nvg.getBackendParams();
+	backend = params;
+	params.renderStroke = captureStroke;
+	nvg.beginFrame(640, 480, 1);
+}
+
+static void endCapture(ofxNanoVG& nvg)
+{
+	nvg.endFrame();
+	nvg.getBackendParams().renderStroke = backend.renderStroke;
+}
+
+TEST(hairlineStrokes)
+{
+	ofxNanoVG& nvg = ofxNanoVG::one();
+
+	// an open line is a cap of four vertices at each end
+	beginCapture(nvg);
+	nvg.setLineCap(ofxNanoVG::NVG_SQUARE);
+	nvg.setLineJoin(ofxNanoVG::NVG_ROUND);
+	nvg.strokeLine(10, 10, 110, 10, ofColor(255), 0.5f);
+	CHECK(nvg.getHairlineStrokeCount() == 1);
+	endCapture(nvg);
+	CHECK(strokes.size() == 1);
+	if (strokes.size() == 1) {
+		CHECK(strokes[0].size() == 8);
+		// butt caps only reach out over the AA fringe, a square cap of the
+		// set line cap would be ignored
+		for (const NVGvertex& v : strokes[0]) {
+			CHECK(v.x >= 10 - 1 && v.x <= 110 + 1);
+			CHECK(v.y >= 10 - 1 && v.y <= 10 + 1);
+		}
+	}
+
+	// one cross-section per inner point of a polyline, none per join
+	ofPolyline zigzag;
+	for (int i=0; i<10; i++) {
+		zigzag.addVertex(10 + i*20, i % 2 ? 50 : 30);
+	}
+	beginCapture(nvg);
+	nvg.strokePolyline(zigzag, ofColor(255), 0.5f);
+	CHECK(nvg.getHairlineStrokeCount() == 1);
+	endCapture(nvg);
+	CHECK(strokes.size() == 1 && strokes[0].size() == 4 + 8*2 + 4);
+
+	// a closed rectangle is one cross-section per corner and the closing pair
+	beginCapture(nvg);
+	nvg.strokeRect(10, 10, 50, 50, ofColor(255), 0.5f);
+	CHECK(nvg.getHairlineStrokeCount() == 1);
+	endCapture(nvg);
+	CHECK(strokes.size() == 1 && strokes[0].size() == 4*2 + 2);
+
+	// wider strokes and a disabled fast path go through nvgStroke
+	beginCapture(nvg);
+	nvg.strokeLine(10, 10, 110, 10, ofColor(255), 2);
+	nvg.setHairlineFastPath(false);
+	nvg.strokeLine(10, 20, 110, 20, ofColor(255), 0.5f);
+	nvg.setHairlineFastPath(true);
+	CHECK(nvg.getHairlineStrokeCount() == 0);
+	endCapture(nvg);
+	CHECK(strokes.size() == 2);
+}
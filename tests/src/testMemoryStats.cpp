@@ -0,0 +1,63 @@
+//
+//  testMemoryStats.cpp
+//  ofxNanoVG tests
+//
+//  Memory stats of paths whose size in NanoVG's buffers is known from
+//  nanovg.c, and what trim resets.
+//
+
+#include "ofxNanoVG.h"
+#include "ofxNanoVGTest.h"
+
+// 7 floats and the flags byte of NVGpoint in nanovg.c, padded
+#define NVGPOINT_SIZE 32
+
+TEST(memoryStatsCounts)
+{
+	ofxNanoVG& nvg = ofxNanoVG::one();
+	const ofxNanoVG::MemoryStats& stats = nvg.getMemoryStats();
+
+	// nvgRect is a moveTo, three lineTos and a close: 13 floats and 4 points.
+	// Its AA fill is a fan of 4 vertices and a fringe strip of (4+1)*2
+	nvg.beginFrame(640, 480, 1);
+	nvg.fillRect(10, 10, 100, 50, ofColor(255, 0, 0));
+	CHECK(stats.commands.current == 13*sizeof(float));
+	CHECK(stats.points.current == 4*NVGPOINT_SIZE);
+	CHECK(stats.paths.current == sizeof(NVGpath));
+	CHECK(stats.vertices.current == (4 + 10)*sizeof(NVGvertex));
+
+	// a butt capped line is 6 floats, 2 points and two caps of 4 vertices
+	nvg.strokeLine(10, 100, 200, 100, ofColor(0, 255, 0), 4);
+	CHECK(stats.commands.current == 6*sizeof(float));
+	CHECK(stats.points.current == 2*NVGPOINT_SIZE);
+	CHECK(stats.vertices.current == 8*sizeof(NVGvertex));
+
+	// the largest path so far, and every vertex of the frame
+	CHECK(stats.commands.highWater >= 13*sizeof(float));
+	CHECK(stats.vertices.highWater >= 14*sizeof(NVGvertex));
+	CHECK(stats.frameVertices.current == (14 + 8)*sizeof(NVGvertex));
+	nvg.endFrame();
+
+	// trim starts the counts over, and tells paints made before it are stale
+	ofTexture tex;
+	bool bArbTex = ofGetUsingArbTex();
+	ofDisableArbTex();
+	tex.allocate(16, 16, GL_RGBA);
+	if (bArbTex) {
+		ofEnableArbTex();
+	}
+	NVGpaint paint = nvg.getTexturePaint(tex);
+	CHECK(paint.image > 0);
+	CHECK(nvg.getTexturePaint(tex).image == paint.image);
+
+	int trims = nvg.getTrimCount();
+	nvg.trim();
+	CHECK(nvg.getTrimCount() == trims + 1);
+	CHECK(stats.commands.highWater == 0);
+	CHECK(stats.vertices.highWater == 0);
+
+	// the texture outlives the old context, a new image is made for it
+	CHECK(tex.isAllocated());
+	CHECK(glIsTexture(tex.getTextureData().textureID));
+	CHECK(nvg.getTexturePaint(tex).image > 0);
+}
@@ -0,0 +1,147 @@
+//
+//  testQueue.cpp
+//  ofxNanoVG tests
+//
+//  Fills and strokes tessellated by the thread pool reach the backend the
+//  same as when they are drawn right away.
+//
+
+#include "ofxNanoVG.h"
+#include "ofxNanoVGTest.h"
+
+// every call to the backend's renderFill and renderStroke, flattened
+static vector<float> captured;
+static NVGparams backend;
+
+static void capturePath(const NVGpath& path, bool fill)
+{
+	captured.push_back(path.closed);
+	if (fill) {
+		captured.push_back(path.nfill);
+		for (int i=0; i<path.nfill; i++) {
+			captured.insert(captured.end(), &path.fill[i].x, &path.fill[i].x + 4);
+		}
+	}
+	captured.push_back(path.nstroke);
+	for (int i=0; i<path.nstroke; i++) {
+		captured.insert(captured.end(), &path.stroke[i].x, &path.stroke[i].x + 4);
+	}
+}
+
+static void captureFill(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, const float* bounds, const NVGpath* paths, int npaths)
+{
+	captured.push_back(0);
+	captured.insert(captured.end(), &paint->innerColor.r, &paint->innerColor.r + 4);
+	captured.push_back(fringe);
+	captured.insert(captured.end(), bounds, bounds + 4);
+	for (int i=0; i<npaths; i++) {
+		capturePath(paths[i], true);
+	}
+	backend.renderFill(uptr, paint, scissor, fringe, bounds, paths, npaths);
+}
+
+static void captureStroke(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths)
+{
+	captured.push_back(1);
+	captured.insert(captured.end(), &paint->innerColor.r, &paint->innerColor.r + 4);
+	captured.push_back(fringe);
+	captured.push_back(strokeWidth);
+	for (int i=0; i<npaths; i++) {
+		capturePath(paths[i], false);
+	}
+	backend.renderStroke(uptr, paint, scissor, fringe, strokeWidth, paths, npaths);
+}
+
+// enough paths and points for the pool to split them between its threads
+static vector<float> drawScene(ofxNanoVG& nvg)
+{
+	captured.clear();
+	NVGparams& params = nvg.getBackendParams();
+	backend = params;
+	params.renderFill = captureFill;
+	params.renderStroke = captureStroke;
+
+	nvg.beginFrame(640, 480, 2);
+	for (int i=0; i<200; i++) {
+		float x = (i % 20) * 30;
+		float y = (i / 20) * 45;
+		nvg.setFillColor(ofFloatColor(i / 200.0f, 0.5f, 0, 1));
+		nvg.setStrokeColor(ofFloatColor(0, i / 200.0f, 1, 0.5f));
+		nvg.setStrokeWidth(1 + (i % 7));
+		nvg.setLineCap((ofxNanoVG::LineParam)(i % 3));
+		nvg.setLineJoin(i % 2 ? ofxNanoVG::NVG_ROUND : ofxNanoVG::NVG_MITER);
+		switch (i % 5) {
+			case 0:
+				nvg.fillRect(x, y, 20, 30, ofColor(255, 0, 0));
+				break;
+			case 1:
+				nvg.beginPath();
+				nvg.ellipse(x + 10, y + 15, 10, 15);
+				nvg.fillPath();
+				break;
+			case 2:
+				// concave, drawn with the stencil buffer
+				nvg.beginPath();
+				nvg.moveTo(x, y);
+				nvg.lineTo(x + 20, y + 30);
+				nvg.lineTo(x + 20, y);
+				nvg.lineTo(x, y + 30);
+				nvg.fillPath();
+				break;
+			case 3:
+				nvg.beginPath();
+				nvg.moveTo(x, y);
+				nvg.bezierTo(x + 30, y, x - 10, y + 30, x + 20, y + 30);
+				nvg.strokePath();
+				break;
+			case 4:
+				nvg.translateMatrix(5, 3);
+				nvg.beginPath();
+				nvg.arc(x + 10, y + 15, 12, 0, PI * 1.5f, 1);
+				nvg.lineTo(x + 10, y + 15);
+				nvg.strokePath();
+				nvg.resetMatrix();
+				break;
+		}
+	}
+	nvg.endFrame();
+
+	params.renderFill = backend.renderFill;
+	params.renderStroke = backend.renderStroke;
+	return captured;
+}
+
+static float maxDifference(const vector<float>& a, const vector<float>& b)
+{
+	if (a.size() != b.size()) {
+		return 1e30f;
+	}
+	float worst = 0;
+	for (size_t i=0; i<a.size(); i++) {
+		worst = max(worst, fabsf(a[i] - b[i]));
+	}
+	return worst;
+}
+
+TEST(queuedMatchesDirect)
+{
+	ofxNanoVG& nvg = ofxNanoVG::one();
+	CHECK(nvg.getNumThreads() == 1);
+
+	vector<float> direct = drawScene(nvg);
+	CHECK(!direct.empty());
+
+	nvg.setNumThreads(4);
+	CHECK(nvg.getNumThreads() == 4);
+	vector<float> queued = drawScene(nvg);
+	CHECK(queued.size() == direct.size());
+	CHECK(maxDifference(queued, direct) < 1e-4f);
+
+	// the threads an item lands on don't change the result
+	for (int i=0; i<5; i++) {
+		CHECK(drawScene(nvg) == queued);
+	}
+
+	nvg.setNumThreads(1);
+	CHECK(drawScene(nvg) == direct);
+}
@@ -0,0 +1,113 @@
+//
+//  testRampImages.cpp
+//  ofxNanoVG tests
+//
+//  Color ramp textures kept across frames, reused for new ramps of the same
+//  width and deleted once they go unused.
+//
+
+#include "ofxNanoVG.h"
+#include "ofxNanoVGTest.h"
+
+// the context's texture calls and the images the ramp strokes were drawn with
+static int created, updated;
+static vector<int> deleted;
+static vector<int> drawn;
+static NVGparams backend, context;
+
+static int captureCreate(void* uptr, int type, int w, int h, int imageFlags, const unsigned char* data)
+{
+	created++;
+	return context.renderCreateTexture(uptr, type, w, h, imageFlags, data);
+}
+
+static int captureUpdate(void* uptr, int image, int x, int y, int w, int h, const unsigned char* data)
+{
+	updated++;
+	return context.renderUpdateTexture(uptr, image, x, y, w, h, data);
+}
+
+static int captureDelete(void* uptr, int image)
+{
+	deleted.push_back(image);
+	return context.renderDeleteTexture(uptr, image);
+}
+
+static void captureTriangles(void* uptr, NVGpaint* paint, NVGscissor* scissor, const NVGvertex* verts, int nverts)
+{
+	drawn.push_back(paint->image);
+	backend.renderTriangles(uptr, paint, scissor, verts, nverts);
+}
+
+// one frame, with a ramp stroke per colors; returns their images
+static vector<int> drawFrame(ofxNanoVG& nvg, const vector<vector<ofFloatColor> >& ramps)
+{
+	created = updated = 0;
+	deleted.clear();
+	drawn.clear();
+
+	ofPolyline line;
+	line.addVertex(10, 10);
+	line.addVertex(200, 40);
+	line.addVertex(300, 10);
+	nvg.beginFrame(640, 480, 1);
+	for (const vector<ofFloatColor>& ramp : ramps) {
+		nvg.strokePolyline(line, ramp, 4);
+	}
+	nvg.endFrame();
+	return drawn;
+}
+
+TEST(rampImageCache)
+{
+	ofxNanoVG& nvg = ofxNanoVG::one();
+	NVGparams* params = nvgInternalParams(nvg.getContext());
+	context = *params;
+	params->renderCreateTexture = captureCreate;
+	params->renderUpdateTexture = captureUpdate;
+	params->renderDeleteTexture = captureDelete;
+	NVGparams& backendParams = nvg.getBackendParams();
+	backend = backendParams;
+	backendParams.renderTriangles = captureTriangles;
+
+	vector<ofFloatColor> a, b, c;
+	for (int i=0; i<3; i++) {
+		a.push_back(ofFloatColor(i / 2.0f, 0, 0));
+		b.push_back(ofFloatColor(0, i / 2.0f, 0));
+		c.push_back(ofFloatColor(0, 0, i / 2.0f));
+	}
+	vector<vector<ofFloatColor> > none;
+
+	// textures left by earlier tests are gone after two empty frames
+	drawFrame(nvg, none);
+	drawFrame(nvg, none);
+
+	// a ramp is uploaded once, drawn again in the next frame it is reused
+	vector<int> first = drawFrame(nvg, vector<vector<ofFloatColor> >(1, a));
+	CHECK(first.size() == 1 && first[0] > 0);
+	CHECK(created == 1);
+	vector<int> second = drawFrame(nvg, vector<vector<ofFloatColor> >(2, a));
+	CHECK(second.size() == 2 && second[0] == first[0] && second[1] == first[0]);
+	CHECK(created == 0 && updated == 0 && deleted.empty());
+
+	// a new ramp while a is drawn needs its own texture
+	vector<int> withB = drawFrame(nvg, vector<vector<ofFloatColor> >(1, b));
+	CHECK(withB.size() == 1 && withB[0] != first[0]);
+	CHECK(created == 1 && deleted.empty());
+
+	// a went unused in the last frame, its texture takes c's colors
+	vector<int> withC = drawFrame(nvg, vector<vector<ofFloatColor> >(1, c));
+	CHECK(withC.size() == 1 && withC[0] == first[0]);
+	CHECK(created == 0 && updated == 1 && deleted.empty());
+
+	// a texture unused for a whole frame goes at the end of the next one
+	drawFrame(nvg, none);
+	CHECK(deleted.size() == 1 && deleted[0] == withB[0]);
+	drawFrame(nvg, none);
+	CHECK(deleted.size() == 1 && deleted[0] == withC[0]);
+	drawFrame(nvg, none);
+	CHECK(deleted.empty() && created == 0);
+
+	*params = context;
+	backendParams.renderTriangles = backend.renderTriangles;
+}
@@ -0,0 +1,105 @@
+//
+//  testShapeIndex.cpp
+//  ofxNanoVG tests
+//
+//  Picking through the shape index against a brute force search, and fills
+//  with inner contours, solid or holes.
+//
+
+#include "ofxNanoVGShapeIndex.h"
+#include "ofxNanoVGTest.h"
+
+static void addSquare(ofxNanoVGShapeIndex& index, int id, float x, float y, float size)
+{
+	ofVec2f points[4] = { ofVec2f(x, y), ofVec2f(x+size, y), ofVec2f(x+size, y+size), ofVec2f(x, y+size) };
+	ofxNanoVGShapeIndex::Contour contour = { 0, 4, true };
+	index.addShape(id, ofxNanoVGShapeIndex::SHAPE_FILL, 0, points, &contour, 1);
+}
+
+TEST(shapeIndexPicking)
+{
+	// many small overlapping squares give a deep tree
+	ofxNanoVGShapeIndex index;
+	vector<ofRectangle> squares;
+	unsigned int seed = 1;
+	auto random = [&seed](float range) {
+		seed = seed * 1103515245u + 12345u;
+		return (float)((seed >> 8) & 0xffff) / 0xffff * range;
+	};
+	for (int i=0; i<20000; i++) {
+		ofRectangle r(random(1000), random(1000), 2 + random(20), 0);
+		r.height = r.width;
+		squares.push_back(r);
+		addSquare(index, i, r.x, r.y, r.width);
+	}
+	index.build();
+	CHECK(index.size() == squares.size());
+
+	int mismatches = 0;
+	for (int i=0; i<2000; i++) {
+		float x = random(1020);
+		float y = random(1020);
+		int expected = -1;
+		for (int s=squares.size()-1; s>=0; s--) {
+			const ofRectangle& r = squares[s];
+			if (x >= r.x && x <= r.x+r.width && y >= r.y && y <= r.y+r.height) {
+				expected = s;
+				break;
+			}
+		}
+		if (index.pick(x, y) != expected) {
+			mismatches++;
+		}
+	}
+	CHECK(mismatches == 0);
+
+	// later shapes are on top, strokes are hit within half their width plus the tolerance
+	ofxNanoVGShapeIndex layers;
+	layers.setStrokeTolerance(2);
+	addSquare(layers, 1, 0, 0, 100);
+	addSquare(layers, 2, 50, 50, 100);
+	ofVec2f line[2] = { ofVec2f(0, 200), ofVec2f(100, 200) };
+	ofxNanoVGShapeIndex::Contour contour = { 0, 2, false };
+	layers.addShape(3, ofxNanoVGShapeIndex::SHAPE_STROKE, 4, line, &contour, 1);
+	layers.build();
+	CHECK(layers.pick(25, 25) == 1);
+	CHECK(layers.pick(75, 75) == 2);
+	CHECK(layers.pick(50, 203.5f) == 3);
+	CHECK(layers.pick(50, 204.5f) == -1);
+	CHECK(layers.pick(300, 300) == -1);
+}
+
+// a square with a square inside, both contours clockwise or the inner one
+// reversed, as two fills marked solid or hole
+static void addFrame(ofxNanoVGShapeIndex& index, int id, bool reversed, bool hole)
+{
+	ofVec2f points[8] = {
+		ofVec2f(0, 0), ofVec2f(100, 0), ofVec2f(100, 100), ofVec2f(0, 100),
+		ofVec2f(25, 25), ofVec2f(75, 25), ofVec2f(75, 75), ofVec2f(25, 75)
+	};
+	if (reversed) {
+		std::reverse(points + 4, points + 8);
+	}
+	ofxNanoVGShapeIndex::Contour contours[2] = { { 0, 4, true, false }, { 4, 4, true, hole } };
+	index.addShape(id, ofxNanoVGShapeIndex::SHAPE_FILL, 0, points, contours, 2);
+}
+
+TEST(shapeIndexHoles)
+{
+	// NanoVG turns every sub-path solid unless it is marked as a hole, so a
+	// reversed inner contour alone still fills the middle
+	const bool reversed[] = { false, true };
+	for (bool r : reversed) {
+		ofxNanoVGShapeIndex solid;
+		addFrame(solid, 1, r, false);
+		solid.build();
+		CHECK(solid.pick(10, 10) == 1);
+		CHECK(solid.pick(50, 50) == 1);
+
+		ofxNanoVGShapeIndex hole;
+		addFrame(hole, 1, r, true);
+		hole.build();
+		CHECK(hole.pick(10, 10) == 1);
+		CHECK(hole.pick(50, 50) == -1);
+	}
+}
@@ -0,0 +1,210 @@
+//
+//  testSimd.cpp
+//  ofxNanoVG tests
+//
+//  Every vector kernel against its scalar loop, and the speed of both, on
+//  their own and in a scene of hairlines and ramp strokes.
+//
+
+#include "ofxNanoVG.h"
+#include "ofxNanoVGSimd.h"
+#include "ofxNanoVGTest.h"
+
+// odd so every kernel also runs its remainder loop
+#define NUM_POINTS 1003
+
+static float randomFloat(unsigned int& seed, float range)
+{
+	seed = seed * 1103515245u + 12345u;
+	return (float)((seed >> 8) & 0xffff) / 0xffff * range;
+}
+
+// the largest difference relative to the magnitude of the values
+static float compare(const float* a, const float* b, int count)
+{
+	float worst = 0;
+	for (int i=0; i<count; i++) {
+		worst = max(worst, fabsf(a[i] - b[i]) / max(1.0f, fabsf(b[i])));
+	}
+	return worst;
+}
+
+// points per microsecond of kernel, run with the vector code on or off
+template<typename Kernel>
+static float measure(bool simd, int points, Kernel kernel)
+{
+	ofxNanoVGSimd::setEnabled(simd);
+	int runs = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	float micros = 0;
+	while (micros < 20000) {
+		for (int i=0; i<100; i++) {
+			kernel();
+		}
+		runs += 100;
+		micros = std::chrono::duration<float, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+	ofxNanoVGSimd::setEnabled(true);
+	return (float)runs * points / micros;
+}
+
+template<typename Kernel>
+static void logThroughput(const char* name, int points, Kernel kernel)
+{
+	float simd = measure(true, points, kernel);
+	float scalar = measure(false, points, kernel);
+	ofLogNotice("ofxNanoVGTest") << name << ": " << ofxNanoVGSimd::getInstructionSet() << " " << simd
+		<< " points/us, scalar " << scalar << " points/us (" << simd / scalar << "x)";
+}
+
+TEST(simdKernels)
+{
+	unsigned int seed = 1;
+	vector<float> p(NUM_POINTS*2), normals(NUM_POINTS*2);
+	for (int i=0; i<NUM_POINTS; i++) {
+		// a walk, so no two consecutive points coincide
+		p[i*2] = (i > 0 ? p[i*2-2] : 0) + 1 + randomFloat(seed, 10);
+		p[i*2+1] = (i > 0 ? p[i*2-1] : 0) + randomFloat(seed, 10) - 5;
+		float a = randomFloat(seed, TWO_PI);
+		normals[i*2] = cosf(a);
+		normals[i*2+1] = sinf(a);
+	}
+
+	vector<float> a(NUM_POINTS*8), b(NUM_POINTS*8);
+	const float xform[6] = { 0.8f, 0.3f, -0.3f, 0.8f, 120, -40 };
+	auto transform = [&]() { ofxNanoVGSimd::transformPoints(xform, &p[0], &a[0], NUM_POINTS); };
+	transform();
+	ofxNanoVGSimd::setEnabled(false);
+	ofxNanoVGSimd::transformPoints(xform, &p[0], &b[0], NUM_POINTS);
+	ofxNanoVGSimd::setEnabled(true);
+	CHECK(compare(&a[0], &b[0], NUM_POINTS*2) < 1e-5f);
+	logThroughput("transformPoints", NUM_POINTS, transform);
+
+	for (int closed=0; closed<2; closed++) {
+		int nsegs = closed ? NUM_POINTS : NUM_POINTS-1;
+		ofxNanoVGSimd::segmentDirections(&p[0], NUM_POINTS, closed, &a[0]);
+		ofxNanoVGSimd::setEnabled(false);
+		ofxNanoVGSimd::segmentDirections(&p[0], NUM_POINTS, closed, &b[0]);
+		ofxNanoVGSimd::setEnabled(true);
+		CHECK(compare(&a[0], &b[0], nsegs*2) < 1e-5f);
+	}
+	logThroughput("segmentDirections", NUM_POINTS, [&]() { ofxNanoVGSimd::segmentDirections(&p[0], NUM_POINTS, false, &a[0]); });
+
+	vector<NVGvertex> va(NUM_POINTS*2), vb(NUM_POINTS*2);
+	ofxNanoVGSimd::crossSections(&p[0], &normals[0], NUM_POINTS, 1.5f, &va[0]);
+	ofxNanoVGSimd::setEnabled(false);
+	ofxNanoVGSimd::crossSections(&p[0], &normals[0], NUM_POINTS, 1.5f, &vb[0]);
+	ofxNanoVGSimd::setEnabled(true);
+	CHECK(compare((float*)&va[0], (float*)&vb[0], NUM_POINTS*8) < 1e-5f);
+	logThroughput("crossSections", NUM_POINTS, [&]() { ofxNanoVGSimd::crossSections(&p[0], &normals[0], NUM_POINTS, 1.5f, &va[0]); });
+
+	const float offsets[4] = { 3, 2, -2, -3 };
+	ofxNanoVGSimd::offsetSections(&p[0], &normals[0], NUM_POINTS, offsets, &a[0]);
+	ofxNanoVGSimd::setEnabled(false);
+	ofxNanoVGSimd::offsetSections(&p[0], &normals[0], NUM_POINTS, offsets, &b[0]);
+	ofxNanoVGSimd::setEnabled(true);
+	CHECK(compare(&a[0], &b[0], NUM_POINTS*8) < 1e-5f);
+	logThroughput("offsetSections", NUM_POINTS, [&]() { ofxNanoVGSimd::offsetSections(&p[0], &normals[0], NUM_POINTS, offsets, &a[0]); });
+
+	float ba[4], bb[4];
+	ofxNanoVGSimd::vertexBounds(&va[0], va.size(), ba);
+	ofxNanoVGSimd::setEnabled(false);
+	ofxNanoVGSimd::vertexBounds(&va[0], va.size(), bb);
+	ofxNanoVGSimd::setEnabled(true);
+	CHECK(compare(ba, bb, 4) == 0);
+	logThroughput("vertexBounds", va.size(), [&]() { ofxNanoVGSimd::vertexBounds(&va[0], va.size(), ba); });
+
+	const float p0[2] = { 0, 0 }, p1[2] = { 100, 300 }, p2[2] = { 400, -200 }, p3[2] = { 500, 100 };
+	ofxNanoVGSimd::flattenBezier(p0, p1, p2, p3, NUM_POINTS, &a[0]);
+	ofxNanoVGSimd::setEnabled(false);
+	ofxNanoVGSimd::flattenBezier(p0, p1, p2, p3, NUM_POINTS, &b[0]);
+	ofxNanoVGSimd::setEnabled(true);
+	CHECK(compare(&a[0], &b[0], NUM_POINTS*2) < 1e-5f);
+	CHECK_NEAR(a[NUM_POINTS*2-2], p3[0], 1e-3);
+	CHECK_NEAR(a[NUM_POINTS*2-1], p3[1], 1e-3);
+	logThroughput("flattenBezier", NUM_POINTS, [&]() { ofxNanoVGSimd::flattenBezier(p0, p1, p2, p3, NUM_POINTS, &a[0]); });
+}
+
+// the vertices ofxNanoVG hands to the backend, not drawn so the scene
+// measures tessellation only
+static vector<float> sceneVerts;
+
+static void captureStroke(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths)
+{
+	for (int i=0; i<npaths; i++) {
+		sceneVerts.insert(sceneVerts.end(), &paths[i].stroke[0].x, &paths[i].stroke[0].x + paths[i].nstroke*4);
+	}
+}
+
+static void captureTriangles(void* uptr, NVGpaint* paint, NVGscissor* scissor, const NVGvertex* verts, int nverts)
+{
+	sceneVerts.insert(sceneVerts.end(), &verts[0].x, &verts[0].x + nverts*4);
+}
+
+#define SCENE_LINES 200
+#define SCENE_LINE_POINTS 250
+
+// a map layer: rotated, half of the lines hairlines, half colored by a ramp
+static void drawScene(ofxNanoVG& nvg, const vector<ofPolyline>& lines, const vector<float>& values, const vector<ofFloatColor>& ramp)
+{
+	sceneVerts.clear();
+	nvg.beginFrame(1024, 768, 2);
+	nvgTranslate(nvg.getContext(), 512, 384);
+	nvgRotate(nvg.getContext(), 0.3f);
+	nvgTranslate(nvg.getContext(), -512, -384);
+	for (size_t i=0; i<lines.size(); i++) {
+		if (i % 2) {
+			nvg.strokePolyline(lines[i], ofColor(255, 128, 0), 0.4f);
+		}
+		else {
+			nvg.strokePolyline(lines[i], values, ramp, 0, 1, 3);
+		}
+	}
+	nvg.endFrame();
+}
+
+TEST(simdPathScene)
+{
+	ofxNanoVG& nvg = ofxNanoVG::one();
+	unsigned int seed = 2;
+	vector<ofPolyline> lines(SCENE_LINES);
+	for (ofPolyline& line : lines) {
+		float x = randomFloat(seed, 1024);
+		float y = randomFloat(seed, 768);
+		for (int i=0; i<SCENE_LINE_POINTS; i++) {
+			x += randomFloat(seed, 8) - 4;
+			y += randomFloat(seed, 8) - 4;
+			line.addVertex(x, y);
+		}
+	}
+	vector<float> values(SCENE_LINE_POINTS);
+	for (int i=0; i<SCENE_LINE_POINTS; i++) {
+		values[i] = (float)i / SCENE_LINE_POINTS;
+	}
+	vector<ofFloatColor> ramp;
+	ramp.push_back(ofFloatColor(0, 0, 1));
+	ramp.push_back(ofFloatColor(0, 1, 0));
+	ramp.push_back(ofFloatColor(1, 0, 0));
+
+	NVGparams& params = nvg.getBackendParams();
+	NVGparams backend = params;
+	params.renderStroke = captureStroke;
+	params.renderTriangles = captureTriangles;
+
+	drawScene(nvg, lines, values, ramp);
+	vector<float> vectorVerts = sceneVerts;
+	ofxNanoVGSimd::setEnabled(false);
+	drawScene(nvg, lines, values, ramp);
+	ofxNanoVGSimd::setEnabled(true);
+	CHECK(nvg.getHairlineStrokeCount() == SCENE_LINES/2);
+	CHECK(!vectorVerts.empty());
+	CHECK(vectorVerts.size() == sceneVerts.size());
+	if (vectorVerts.size() == sceneVerts.size()) {
+		CHECK(compare(&vectorVerts[0], &sceneVerts[0], sceneVerts.size()) < 1e-5f);
+	}
+
+	logThroughput("path scene", SCENE_LINES*SCENE_LINE_POINTS, [&]() { drawScene(nvg, lines, values, ramp); });
+
+	params.renderStroke = backend.renderStroke;
+	params.renderTriangles = backend.renderTriangles;
+}
@@ -0,0 +1,98 @@
+//
+//  testSprites.cpp
+//  ofxNanoVG tests
+//
+//  Sprite batches reach the GPU as one draw call, whatever their tints.
+//
+
+#include "ofxNanoVG.h"
+#include "ofxNanoVGTest.h"
+
+#define NUM_SPRITES 20000
+
+// the backend's renderTriangles calls, by vertex count
+static vector<int> calls;
+static vector<NVGvertex> firstVerts;
+static NVGparams backend;
+
+static void captureTriangles(void* uptr, NVGpaint* paint, NVGscissor* scissor, const NVGvertex* verts, int nverts)
+{
+	if (calls.empty()) {
+		firstVerts.assign(verts, verts + min(nverts, 6));
+	}
+	calls.push_back(nverts);
+	backend.renderTriangles(uptr, paint, scissor, verts, nverts);
+}
+
+static void drawBatch(ofxNanoVG& nvg, const ofTexture& atlas, const vector<ofRectangle>& dst, const vector<ofRectangle>& src, const vector<ofFloatColor>& tints, bool scissor=false)
+{
+	calls.clear();
+	NVGparams& params = nvg.getBackendParams();
+	backend = params;
+	params.renderTriangles = captureTriangles;
+
+	nvg.beginFrame(640, 480, 1);
+	if (scissor) {
+		nvg.enableScissor(0, 0, 320, 240);
+	}
+	nvg.drawSprites(atlas, dst, src, tints);
+	CHECK(nvg.getSpriteBatchCount() >= 1);
+	nvg.endFrame();
+
+	params.renderTriangles = backend.renderTriangles;
+}
+
+TEST(spriteBatches)
+{
+	ofxNanoVG& nvg = ofxNanoVG::one();
+
+	// drawSprites needs GL_TEXTURE_2D
+	bool bArbTex = ofGetUsingArbTex();
+	ofDisableArbTex();
+	ofTexture atlas;
+	atlas.allocate(64, 64, GL_RGBA);
+	if (bArbTex) {
+		ofEnableArbTex();
+	}
+
+	vector<ofRectangle> dst(NUM_SPRITES), src(NUM_SPRITES);
+	vector<ofFloatColor> tints(NUM_SPRITES);
+	for (int i=0; i<NUM_SPRITES; i++) {
+		dst[i] = ofRectangle((i % 200) * 3, (i / 200) * 4, 8, 8);
+		src[i] = ofRectangle((i % 4) * 16, 0, 16, 16);
+		tints[i] = ofFloatColor((i % 256) / 255.0f, 1 - (i % 100) / 100.0f, 0.5f, 1);
+	}
+
+	// a single tint, for all or repeated per sprite, is one NanoVG draw call
+	drawBatch(nvg, atlas, dst, src, vector<ofFloatColor>(1, ofFloatColor::red));
+	CHECK(calls.size() == 1);
+	CHECK(!calls.empty() && calls[0] == NUM_SPRITES*6);
+	CHECK(nvg.getSpriteBatchCount() == 1);
+	CHECK(firstVerts.size() == 6 && firstVerts[0].x == dst[0].x && firstVerts[0].y == dst[0].y);
+
+	drawBatch(nvg, atlas, dst, src, vector<ofFloatColor>(NUM_SPRITES, ofFloatColor::red));
+	CHECK(calls.size() == 1);
+	CHECK(nvg.getSpriteBatchCount() == 1);
+
+	// a tint per sprite is one draw of a mesh with vertex colors, not through NanoVG
+	drawBatch(nvg, atlas, dst, src, tints);
+	CHECK(calls.empty());
+	CHECK(nvg.getSpriteBatchCount() == 1);
+
+	// NanoVG's draws are flushed before the mesh, the transform is kept
+	nvg.beginFrame(640, 480, 1);
+	nvg.translateMatrix(5, 7);
+	nvg.drawSprites(atlas, dst, src, tints);
+	float xform[6];
+	nvgCurrentTransform(nvg.getContext(), xform);
+	CHECK(xform[4] == 5 && xform[5] == 7);
+	nvg.endFrame();
+
+	// inside a scissor, one NanoVG draw call per run of the same tint
+	vector<ofFloatColor> halves(NUM_SPRITES, ofFloatColor::red);
+	std::fill(halves.begin() + NUM_SPRITES/2, halves.end(), ofFloatColor::blue);
+	drawBatch(nvg, atlas, dst, src, halves, true);
+	CHECK(calls.size() == 2);
+	CHECK(calls.size() == 2 && calls[0] == NUM_SPRITES*3 && calls[1] == NUM_SPRITES*3);
+	CHECK(nvg.getSpriteBatchCount() == 2);
+}
@@ -0,0 +1,113 @@
+//
+//  testTextMeasure.cpp
+//  ofxNanoVG tests
+//
+//  Text measured off the context against nvgTextBounds and
+//  nvgTextBoxBounds, and with the thread count changed between calls.
+//
+
+#include "ofxNanoVGTextMeasure.h"
+#include "ofxNanoVGTest.h"
+
+#define PIXEL_RATIO 2
+
+static bool sameBounds(const ofRectangle& a, const ofRectangle& b)
+{
+	return fabsf(a.x - b.x) < 0.01f && fabsf(a.y - b.y) < 0.01f &&
+		fabsf(a.width - b.width) < 0.01f && fabsf(a.height - b.height) < 0.01f;
+}
+
+TEST(textMeasureMatchesNanoVG)
+{
+	string path = ofxNanoVGTest::findFont();
+	if (path.empty()) {
+		ofLogNotice("ofxNanoVGTest") << "textMeasureMatchesNanoVG: skipped, no font at bin/data/font.ttf";
+		return;
+	}
+
+	ofxNanoVG& nvg = ofxNanoVG::one();
+	ofxNanoVG::Font* font = nvg.addFont("textMeasureTest", path);
+	CHECK(font != NULL);
+	if (font == NULL) {
+		return;
+	}
+
+	const char* texts[] = {
+		"Hello",
+		"The quick brown fox jumps over the lazy dog",
+		"  leading and trailing spaces  ",
+		"first line\nsecond line\r\nthird",
+		"averyveryverylongwordthatdoesnotfitonaline and more"
+	};
+	const float widths[] = { 0, 60, 150, 400 };
+	const ofxNanoVG::TextHorizontalAlign haligns[] = { ofxNanoVG::NVG_ALIGN_LEFT, ofxNanoVG::NVG_ALIGN_CENTER, ofxNanoVG::NVG_ALIGN_RIGHT };
+	const ofxNanoVG::TextVerticalAlign valigns[] = { ofxNanoVG::NVG_ALIGN_BASELINE, ofxNanoVG::NVG_ALIGN_TOP, ofxNanoVG::NVG_ALIGN_MIDDLE };
+
+	ofxNanoVGTextMeasure measure;
+	measure.setPixelRatio(PIXEL_RATIO);
+	nvg.beginFrame(640, 480, PIXEL_RATIO);
+	for (const char* text : texts) {
+		for (float width : widths) {
+			for (int a=0; a<3; a++) {
+				nvg.setTextAlign(haligns[a], valigns[a]);
+				ofxNanoVGTextMeasure::Job job;
+				job.font = font;
+				job.fontSize = 18;
+				job.text = text;
+				job.x = 10;
+				job.y = 20;
+				job.breakRowWidth = width;
+				job.align = haligns[a] | valigns[a];
+
+				ofRectangle expected = width > 0 ?
+					nvg.getTextBoxBounds(font, job.x, job.y, text, job.fontSize, width) :
+					nvg.getTextBounds(font, job.x, job.y, text, job.fontSize);
+				ofRectangle bounds = measure.measure(job).bounds;
+				if (!sameBounds(bounds, expected)) {
+					ofxNanoVGTest::fail(__FILE__, __LINE__, string("\"") + text + "\" width " + ofToString(width) +
+						": " + ofToString(bounds) + " != " + ofToString(expected));
+				}
+			}
+		}
+	}
+	nvg.endFrame();
+}
+
+TEST(textMeasureThreads)
+{
+	string path = ofxNanoVGTest::findFont();
+	if (path.empty()) {
+		ofLogNotice("ofxNanoVGTest") << "textMeasureThreads: skipped, no font at bin/data/font.ttf";
+		return;
+	}
+
+	ofxNanoVG::Font* font = ofxNanoVG::one().addFont("textMeasureTest", path);
+	if (font == NULL) {
+		return;
+	}
+
+	// enough jobs for several tasks of the pool
+	vector<ofxNanoVGTextMeasure::Job> jobs(500);
+	for (size_t i=0; i<jobs.size(); i++) {
+		jobs[i].font = font;
+		jobs[i].fontSize = 10 + i % 20;
+		jobs[i].text = "job " + ofToString(i) + " measured on some thread";
+		jobs[i].breakRowWidth = i % 2 ? 80 : 0;
+	}
+
+	ofxNanoVGTextMeasure measure;
+	measure.setNumThreads(1);
+	vector<ofxNanoVGTextMeasure::Result> expected = measure.measure(jobs);
+
+	// the pool is resized between calls, after it has already run
+	const int threads[] = { 2, 4, 3, 1, 8 };
+	for (int n : threads) {
+		measure.setNumThreads(n);
+		vector<ofxNanoVGTextMeasure::Result> results = measure.measure(jobs);
+		CHECK(results.size() == expected.size());
+		for (size_t i=0; i<results.size() && i<expected.size(); i++) {
+			CHECK(results[i].bounds == expected[i].bounds);
+			CHECK(results[i].lines.size() == expected[i].lines.size());
+		}
+	}
+}
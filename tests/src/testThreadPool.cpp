@@ -0,0 +1,50 @@
+//
+//  testThreadPool.cpp
+//  ofxNanoVG tests
+//
+//  Every index run exactly once, also after the thread count changes.
+//
+
+#include "ofxNanoVGThreadPool.h"
+#include "ofxNanoVGTest.h"
+
+static bool runsEachOnce(ofxNanoVGThreadPool& pool, int count)
+{
+	vector<std::atomic<int>> hits(count);
+	for (std::atomic<int>& h : hits) {
+		h = 0;
+	}
+	std::atomic<int> badThread(0);
+	int nthreads = pool.getNumThreads();
+	pool.parallelFor(count, [&](int i, int thread) {
+		hits[i]++;
+		if (thread < 0 || thread >= nthreads) {
+			badThread++;
+		}
+	});
+
+	for (std::atomic<int>& h : hits) {
+		if (h != 1) {
+			return false;
+		}
+	}
+	return badThread == 0;
+}
+
+TEST(threadPoolResize)
+{
+	ofxNanoVGThreadPool pool;
+	CHECK(pool.getNumThreads() == 1);
+	CHECK(runsEachOnce(pool, 100));
+
+	// workers started after earlier loops must wait for the next one
+	const int counts[] = { 2, 4, 3, 8, 1, 4 };
+	for (int round=0; round<50; round++) {
+		for (int n : counts) {
+			pool.setNumThreads(n);
+			CHECK(pool.getNumThreads() == n);
+			CHECK(runsEachOnce(pool, 1000));
+			CHECK(runsEachOnce(pool, 3));
+		}
+	}
+}
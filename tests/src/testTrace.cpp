@@ -0,0 +1,97 @@
+//
+//  testTrace.cpp
+//  ofxNanoVG tests
+//
+//  Traces written by ofxNanoVG (and by hand) and read back by the player.
+//
+
+#include "ofxNanoVG.h"
+#include "ofxNanoVGTrace.h"
+#include "ofxNanoVGTest.h"
+
+static int countCalls(const ofxNanoVGTracePlayer& player, int frame, int op)
+{
+	int count = 0;
+	for (const ofxNanoVGTracePlayer::Call& call : player.getCalls()) {
+		if (call.frame == frame && call.op == op) {
+			count++;
+		}
+	}
+	return count;
+}
+
+TEST(traceRoundTrip)
+{
+	const string filename = "test.nvgt";
+	unsigned char pixels[4*4*4];
+	memset(pixels, 255, sizeof(pixels));
+
+	// a frame flushed once (two segments) and a plain one
+	ofxNanoVGTrace trace;
+	CHECK(trace.open(filename));
+	trace.beginFrame(100, 100, 1, false);
+	trace.beginPath();
+	trace.rect(10, 10, 20, 20);
+	trace.fill();
+	trace.endFrame();
+	trace.beginFrame(100, 100, 1, true);
+	trace.image(7, 4, 4, 0, pixels);
+	trace.fillPaint(nvgImagePattern(NULL, 0, 0, 4, 4, 0, 7, 1));
+	trace.beginPath();
+	trace.rect(0, 0, 4, 4);
+	trace.fill();
+	trace.deleteImage(7);
+	trace.endFrame();
+	trace.beginFrame(100, 100, 1, false);
+	trace.beginPath();
+	trace.ellipse(50, 50, 10, 10);
+	trace.stroke();
+	trace.endFrame();
+	// cut short, dropped
+	trace.beginFrame(100, 100, 1, false);
+	trace.beginPath();
+	trace.close();
+
+	ofxNanoVGTracePlayer player;
+	CHECK(player.load(filename));
+	CHECK(player.getNumFrames() == 2);
+
+	NVGcontext* ctx = ofxNanoVGTracePlayer::createHeadlessContext();
+	CHECK(ctx != NULL);
+	player.replay(ctx);
+	CHECK(countCalls(player, 0, ofxNanoVGTrace::OP_BEGIN_FRAME) == 2);
+	CHECK(countCalls(player, 0, ofxNanoVGTrace::OP_FILL) == 2);
+	CHECK(countCalls(player, 0, ofxNanoVGTrace::OP_DELETE_IMAGE) == 1);
+	CHECK(countCalls(player, 1, ofxNanoVGTrace::OP_STROKE) == 1);
+	CHECK(player.getFrameTime(0) > 0);
+	ofxNanoVGTracePlayer::deleteHeadlessContext(ctx);
+
+	// frames split by flush and pushFrame are still one frame each
+	ofxNanoVG& nvg = ofxNanoVG::one();
+	CHECK(nvg.beginTrace(filename, 2));
+	nvg.beginFrame(200, 200, 1);
+	nvg.fillRect(10, 10, 50, 50, ofColor::red);
+	nvg.flush();
+	nvg.fillRect(20, 20, 50, 50, ofColor::white);
+	nvg.endFrame();
+	nvg.beginFrame(200, 200, 1);
+	nvg.pushFrame();
+	nvg.beginFrame(100, 100, 1);
+	nvg.fillCircle(50, 50, 20, ofColor::white);
+	nvg.endFrame();
+	nvg.popFrame();
+	nvg.fillCircle(100, 100, 20, ofColor::red);
+	nvg.endFrame();
+	CHECK(!nvg.isTracing());
+
+	CHECK(player.load(filename));
+	CHECK(player.getNumFrames() == 2);
+	ctx = ofxNanoVGTracePlayer::createHeadlessContext();
+	player.replay(ctx);
+	CHECK(countCalls(player, 0, ofxNanoVGTrace::OP_FILL) == 2);
+	CHECK(countCalls(player, 1, ofxNanoVGTrace::OP_BEGIN_FRAME) == 3);
+	CHECK(countCalls(player, 1, ofxNanoVGTrace::OP_FILL) == 2);
+	ofxNanoVGTracePlayer::deleteHeadlessContext(ctx);
+
+	ofFile::removeFile(filename);
+}